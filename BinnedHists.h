@@ -0,0 +1,152 @@
+#ifndef BinnedHists_h
+#define BinnedHists_h
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TDirectory.h>
+
+// Comma-separated increasing bin edges, at least two
+inline bool ParseBinEdges(const std::string &list, std::vector<double> &edges) {
+  std::vector<double> parsed;
+  std::string item = list;
+  std::replace(item.begin(), item.end(), ',', ' ');
+  std::istringstream fields(item);
+  double edge;
+  while (fields >> edge) {
+    if (!parsed.empty() && edge<=parsed.back()) return false;
+    parsed.push_back(edge);
+  }
+  if (!fields.eof() || parsed.size()<2) return false;
+  edges = parsed;
+  return true;
+}
+
+
+// TMass and MET histograms per muon eta bin and charge, filled in the event loop instead of
+// (or next to) the unbinned dataset. Histograms are owned here and not attached to a file;
+// each thread fills its own copy and Add() merges them.
+class BinnedHists {
+public:
+  enum Mode { kOff=0, kBoth, kOnly };
+
+  int mode;                 // kBoth: next to the dataset, kOnly: instead of it
+  int nMass, nMET;          // bins over the TMass and MET ranges
+  std::vector<double> etaEdges;
+
+  BinnedHists() : mode(kOff), nMass(80), nMET(50), massMin(0), massMax(0), metMin(0), metMax(0) {
+    const double edges[] = {-2.4, -1.6, -0.8, 0, 0.8, 1.6, 2.4};
+    etaEdges.assign(edges, edges+7);
+  }
+  BinnedHists(const BinnedHists &other) { *this = other; }
+  ~BinnedHists() { Clear(); }
+
+  BinnedHists &operator=(const BinnedHists &other) {
+    if (this==&other) return *this;
+    Clear();
+    mode = other.mode;
+    nMass = other.nMass;
+    nMET = other.nMET;
+    etaEdges = other.etaEdges;
+    massMin = other.massMin; massMax = other.massMax;
+    metMin = other.metMin; metMax = other.metMax;
+    for (unsigned int idx=0; idx<other.hists.size(); idx++) {
+      hists.push_back((TH1*)other.hists[idx]->Clone());
+      hists.back()->SetDirectory(0);
+    }
+    return *this;
+  }
+
+  // mode[:nMass:nMET] with mode both or only; nMass and nMET are left alone when not given
+  static bool Parse(const std::string &spec, int &mode, int &nMass, int &nMET) {
+    if (spec=="") { mode = kOff; return true; }
+    std::string item = spec;
+    std::replace(item.begin(), item.end(), ':', ' ');
+    std::istringstream fields(item);
+    std::string name;
+    if (!(fields >> name)) return false;
+    int m = nMass, e = nMET;
+    if (!fields.eof() && (!(fields >> m >> e) || m<=0 || e<=0)) return false;
+    if (!(fields >> std::ws).eof()) return false;      // leftovers such as both:80:50:10
+    if (name=="both") mode = kBoth;
+    else if (name=="only") mode = kOnly;
+    else return false;
+    nMass = m;
+    nMET = e;
+    return true;
+  }
+
+  bool Configure(const std::string &spec) { return Parse(spec, mode, nMass, nMET); }
+
+  bool SetEtaEdges(const std::string &list) { return ParseBinEdges(list, etaEdges); }
+
+  bool Active() const { return mode!=kOff; }
+  int  NEtaBins() const { return etaEdges.size()-1; }
+
+  // Book the histograms over the given TMass and MET ranges
+  void Book(double _massMin, double _massMax, double _metMin, double _metMax) {
+    Clear();
+    massMin = _massMin; massMax = _massMax;
+    metMin = _metMin; metMax = _metMax;
+    const char *charges[] = {"minus", "plus"};
+    for (int ie=0; ie<NEtaBins(); ie++) {
+      for (int q=0; q<2; q++) {
+        std::string tag = Form("eta%d_%s", ie, charges[q]);
+        std::string range = Form("%g<#eta<%g, %s", etaEdges[ie], etaEdges[ie+1], charges[q]);
+        hists.push_back(new TH1D(("hTMass_"+tag).c_str(), (range+";TMass [GeV/c^{2}]").c_str(), nMass, massMin, massMax));
+        hists.push_back(new TH1D(("hMET_"+tag).c_str(), (range+";MET [GeV]").c_str(), nMET, metMin, metMax));
+        hists.push_back(new TH2D(("hTMassMET_"+tag).c_str(), (range+";TMass [GeV/c^{2}];MET [GeV]").c_str(),
+                                 nMass, massMin, massMax, nMET, metMin, metMax));
+      }
+    }
+    for (unsigned int idx=0; idx<hists.size(); idx++) hists[idx]->SetDirectory(0);
+  }
+
+  // Same binning as other, empty; for per-thread copies
+  void BookAs(const BinnedHists &other) {
+    mode = other.mode;
+    nMass = other.nMass;
+    nMET = other.nMET;
+    etaEdges = other.etaEdges;
+    if (other.hists.empty()) Clear();
+    else Book(other.massMin, other.massMax, other.metMin, other.metMax);
+  }
+
+  void Fill(float mt, float met, float eta, float charge) {
+    if (hists.empty() || eta<etaEdges.front() || eta>=etaEdges.back()) return;
+    int ie = std::upper_bound(etaEdges.begin(), etaEdges.end(), eta) - etaEdges.begin() - 1;
+    TH1 **h = &hists[(2*ie + (charge>0))*3];
+    h[0]->Fill(mt);
+    h[1]->Fill(met);
+    ((TH2D*)h[2])->Fill(mt, met);
+  }
+
+  void Add(const BinnedHists &other) {
+    for (unsigned int idx=0; idx<hists.size() && idx<other.hists.size(); idx++) hists[idx]->Add(other.hists[idx]);
+  }
+
+  // Written into the subdirectory name of dir
+  void Write(TDirectory *dir, const std::string &name) const {
+    if (hists.empty()) return;
+    TDirectory *sub = dir->GetDirectory(name.c_str());
+    if (!sub) sub = dir->mkdir(name.c_str());
+    sub->cd();
+    for (unsigned int idx=0; idx<hists.size(); idx++) hists[idx]->Write(0, TObject::kOverwrite);
+    dir->cd();
+  }
+
+private:
+  double massMin, massMax, metMin, metMax;
+  std::vector<TH1*> hists;  // per eta bin and charge: TMass, MET, TMass vs MET
+
+  void Clear() {
+    for (unsigned int idx=0; idx<hists.size(); idx++) delete hists[idx];
+    hists.clear();
+  }
+};
+
+#endif
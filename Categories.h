@@ -0,0 +1,71 @@
+#ifndef Categories_h
+#define Categories_h
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "RooCategory.h"
+
+#include "BinnedHists.h"
+
+// Category of a candidate from its charge, eta bin and optionally centrality bin,
+// stored as the RooCategory "Category" so that fits select slices without reduce().
+// Values outside the edges go to the first or last bin.
+class CategoryScheme {
+public:
+  enum Mode { kOff=0, kColumn, kSplit };
+
+  int mode;                 // kColumn: Category column, kSplit: also one dataset per category
+  std::vector<double> etaEdges;
+  std::vector<double> centEdges;    // CentBin edges, empty for no centrality bins
+
+  CategoryScheme() : mode(kOff) {
+    const double edges[] = {-2.4, -1.6, -0.8, 0, 0.8, 1.6, 2.4};
+    etaEdges.assign(edges, edges+7);
+  }
+
+  // column|split[:centEdges]
+  static bool Parse(const std::string &spec, int &mode, std::vector<double> &centEdges) {
+    if (spec=="") { mode = kOff; return true; }
+    std::string::size_type colon = spec.find(':');
+    std::string name = spec.substr(0, colon);
+    if (name=="column") mode = kColumn;
+    else if (name=="split") mode = kSplit;
+    else return false;
+    if (colon==std::string::npos) centEdges.clear();
+    else if (!ParseBinEdges(spec.substr(colon+1), centEdges)) return false;
+    return true;
+  }
+
+  bool Configure(const std::string &spec) { return Parse(spec, mode, centEdges); }
+
+  bool Active() const { return mode!=kOff; }
+  int  NEta() const { return etaEdges.size()-1; }
+  int  NCent() const { return centEdges.empty() ? 1 : centEdges.size()-1; }
+  int  Size() const { return 2*NEta()*NCent(); }
+
+  int Index(float charge, float eta, int cent) const {
+    int ie = Bin(etaEdges, eta);
+    int ic = centEdges.empty() ? 0 : Bin(centEdges, cent);
+    return (ic*NEta() + ie)*2 + (charge>0);
+  }
+
+  std::string Label(int index) const {
+    std::string label = Form("%s_eta%d", index%2 ? "plus" : "minus", (index/2)%NEta());
+    if (!centEdges.empty()) label += Form("_cent%d", index/2/NEta());
+    return label;
+  }
+
+  void Define(RooCategory &category) const {
+    for (int idx=0; idx<Size(); idx++) category.defineType(Label(idx).c_str(), idx);
+  }
+
+private:
+  static int Bin(const std::vector<double> &edges, double value) {
+    int bin = std::upper_bound(edges.begin(), edges.end(), value) - edges.begin() - 1;
+    return std::min(std::max(bin, 0), (int)edges.size()-2);
+  }
+};
+
+#endif
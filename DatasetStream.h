@@ -0,0 +1,111 @@
+#ifndef DatasetStream_h
+#define DatasetStream_h
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include <RVersion.h>
+#include <Compression.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+
+#include "RooDataSet.h"
+#include "RooTreeDataStore.h"
+
+// Datasets whose rows go to the output file while reading: RooFit tree storage with its TTree
+// attached to the already-open output TFile, so full baskets are compressed and written out and
+// only the baskets being filled stay in memory. The trees are flushed every flushRows rows and
+// autosaved by ROOT under <dataset>_rows, which is removed once the datasets are written.
+class DatasetStream {
+public:
+  int algorithm;            // ROOT::ECompressionAlgorithm
+  int level;
+  int basketSize;           // bytes per branch basket
+  Long64_t flushRows;       // rows per cluster written to the file
+  TFile *file;              // output file, 0 when not streaming
+
+  DatasetStream() : algorithm(ROOT::kZLIB), level(1), basketSize(32000), flushRows(100000), file(0) {}
+
+  // algo:level[:basketKB], algo zlib|lzma|lz4|zstd as far as this ROOT version has them
+  static bool Parse(const std::string &spec, int &algorithm, int &level, int &basketSize) {
+    if (spec=="") return true;
+    std::string item = spec;
+    std::replace(item.begin(), item.end(), ':', ' ');
+    std::istringstream fields(item);
+    std::string name;
+    int lvl, kb = 32;
+    if (!(fields >> name >> lvl) || lvl<0 || lvl>9) return false;
+    if (fields >> kb && kb<=0) return false;
+    if (name=="zlib") algorithm = ROOT::kZLIB;
+    else if (name=="lzma") algorithm = ROOT::kLZMA;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,12,0)
+    else if (name=="lz4") algorithm = ROOT::kLZ4;
+#endif
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+    else if (name=="zstd") algorithm = ROOT::kZSTD;
+#endif
+    else return false;
+    level = lvl;
+    basketSize = kb*1000;
+    return true;
+  }
+
+  bool Configure(const std::string &spec) { return Parse(spec, algorithm, level, basketSize); }
+
+  bool Active() const { return file!=0; }
+  int  Settings() const { return ROOT::CompressionSettings((ROOT::ECompressionAlgorithm)algorithm, level); }
+
+  // Open the output file; datasets made afterwards with NewDataSet() stream into it
+  bool Open(const std::string &path) {
+    file = new TFile(path.c_str(), "RECREATE");
+    if (file->IsZombie()) {
+      delete file;
+      file = 0;
+      return false;
+    }
+    file->SetCompressionSettings(Settings());
+    return true;
+  }
+
+  RooDataSet *NewDataSet(const char *name, const char *title, const RooArgList &vars) {
+    if (!Active()) return new RooDataSet(name, title, vars);
+    RooAbsData::StorageType type = RooAbsData::getDefaultStorageType();
+    RooAbsData::setDefaultStorageType(RooAbsData::Tree);
+    RooDataSet *data = new RooDataSet(name, title, vars);
+    RooAbsData::setDefaultStorageType(type);
+
+    // The store creates its tree in memory with small baskets
+    TTree *tree = &dynamic_cast<RooTreeDataStore*>(data->store())->tree();
+    tree->SetName((std::string(name)+"_rows").c_str());
+    tree->SetDirectory(file);
+    TIter next(tree->GetListOfBranches());
+    while (TBranch *branch = (TBranch*)next()) branch->SetCompressionSettings(Settings());
+    tree->SetBasketSize("*", basketSize);
+    tree->SetAutoFlush(flushRows);
+    trees.push_back(tree);
+    return data;
+  }
+
+  // Write the baskets still in memory, before the datasets are written
+  void Flush() {
+    for (unsigned int idx=0; idx<trees.size(); idx++) trees[idx]->FlushBaskets();
+  }
+
+  // After the datasets are written: keep the trees with their datasets when the file
+  // is closed, then drop the autosaved copies (Delete() would also delete attached trees)
+  void Detach() {
+    for (unsigned int idx=0; idx<trees.size(); idx++) {
+      trees[idx]->SetDirectory(0);
+      file->Delete((std::string(trees[idx]->GetName())+";*").c_str());
+    }
+    trees.clear();
+  }
+
+private:
+  std::vector<TTree*> trees;
+};
+
+#endif
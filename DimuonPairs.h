@@ -0,0 +1,136 @@
+#ifndef DimuonPairs_h
+#define DimuonPairs_h
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+#include <Rtypes.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DIMUON_AVX2
+#endif
+
+// Opposite-charge muon pairs of an event, for a Z/Drell-Yan veto before the per-muon fill.
+// The pair four-momentum sums go to contiguous buffers, reused from event to event,
+// and the invariant masses are computed for all pairs at once.
+class DimuonPairs {
+public:
+  enum Mode { kOff=0, kVeto, kFlag };
+
+  int mode;
+  float massMin, massMax;   // Z window
+
+  DimuonPairs() : mode(kOff), massMin(76), massMax(106), inWindow(false) {}
+
+  // mode:min:max with mode veto (drop the event) or flag (PairMass and ZFlag columns)
+  static bool Parse(const std::string &spec, int &mode, float &massMin, float &massMax) {
+    if (spec=="") { mode = kOff; return true; }
+    std::string item = spec;
+    std::replace(item.begin(), item.end(), ':', ' ');
+    std::istringstream fields(item);
+    std::string name;
+    float lo, hi;
+    if (!(fields >> name >> lo >> hi) || lo>=hi) return false;
+    if (name=="veto") mode = kVeto;
+    else if (name=="flag") mode = kFlag;
+    else return false;
+    massMin = lo;
+    massMax = hi;
+    return true;
+  }
+
+  bool Configure(const std::string &spec) { return Parse(spec, mode, massMin, massMax); }
+
+  bool Active() const { return mode!=kOff; }
+
+  // Build the pairs of the event; returns true if any pair is in the Z window
+  template <typename Event>
+  bool Build(const Event &evt) {
+    static const float muMass2 = 0.1056584f*0.1056584f;
+    const std::vector<Float_t> &px = *evt.muPx, &py = *evt.muPy, &pz = *evt.muPz;
+    const std::vector<Int_t> &charge = *evt.muCharge;
+    int n = std::min(px.size(), charge.size());
+    energy.resize(n);
+    for (int i=0; i<n; i++) energy[i] = std::sqrt(px[i]*px[i] + py[i]*py[i] + pz[i]*pz[i] + muMass2);
+
+    first.clear(); second.clear();
+    sumE.clear(); sumPx.clear(); sumPy.clear(); sumPz.clear();
+    for (int i=0; i<n; i++) {
+      for (int j=i+1; j<n; j++) {
+        if (charge[i]*charge[j]>=0) continue;
+        first.push_back(i);
+        second.push_back(j);
+        sumE.push_back(energy[i] + energy[j]);
+        sumPx.push_back(px[i] + px[j]);
+        sumPy.push_back(py[i] + py[j]);
+        sumPz.push_back(pz[i] + pz[j]);
+      }
+    }
+    int nPairs = first.size();
+    mass.resize(nPairs);
+    if (nPairs>0) Masses(&sumE[0], &sumPx[0], &sumPy[0], &sumPz[0], &mass[0], nPairs);
+
+    // Per muon, the pair mass closest to the Z mass
+    static const float mZ = 91.1876f;
+    bestMass.assign(n, -1);
+    inWindow = false;
+    for (int p=0; p<nPairs; p++) {
+      float m = mass[p];
+      if (m>massMin && m<massMax) inWindow = true;
+      float &m1 = bestMass[first[p]], &m2 = bestMass[second[p]];
+      if (m1<0 || std::fabs(m-mZ)<std::fabs(m1-mZ)) m1 = m;
+      if (m2<0 || std::fabs(m-mZ)<std::fabs(m2-mZ)) m2 = m;
+    }
+    return inWindow;
+  }
+
+  int   Size() const { return (int)mass.size(); }
+  bool  InWindow() const { return inWindow; }
+  float PairMass(int i_mu) const { return i_mu<(int)bestMass.size() ? bestMass[i_mu] : -1; }
+
+private:
+  std::vector<float> energy, bestMass;
+  std::vector<int> first, second;
+  std::vector<float> sumE, sumPx, sumPy, sumPz, mass;
+  bool inWindow;
+
+  static bool UseAVX2() {
+#ifdef DIMUON_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+  }
+
+  static void Masses(const float *e, const float *px, const float *py, const float *pz, float *out, int n) {
+#ifdef DIMUON_AVX2
+    if (UseAVX2()) return MassesAVX2(e, px, py, pz, out, n);
+#endif
+    for (int i=0; i<n; i++) out[i] = std::sqrt(std::max(e[i]*e[i] - px[i]*px[i] - py[i]*py[i] - pz[i]*pz[i], 0.f));
+  }
+
+#ifdef DIMUON_AVX2
+  // 8 pairs per step with a scalar tail
+  __attribute__((target("avx2")))
+  static void MassesAVX2(const float *e, const float *px, const float *py, const float *pz, float *out, int n) {
+    int i = 0;
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i+8<=n; i+=8) {
+      __m256 ev = _mm256_loadu_ps(e+i), xv = _mm256_loadu_ps(px+i);
+      __m256 yv = _mm256_loadu_ps(py+i), zv = _mm256_loadu_ps(pz+i);
+      __m256 m2 = _mm256_sub_ps(_mm256_mul_ps(ev, ev), _mm256_mul_ps(xv, xv));
+      m2 = _mm256_sub_ps(m2, _mm256_mul_ps(yv, yv));
+      m2 = _mm256_sub_ps(m2, _mm256_mul_ps(zv, zv));
+      _mm256_storeu_ps(out+i, _mm256_sqrt_ps(_mm256_max_ps(m2, zero)));
+    }
+    for (; i<n; i++) out[i] = std::sqrt(std::max(e[i]*e[i] - px[i]*px[i] - py[i]*py[i] - pz[i]*pz[i], 0.f));
+  }
+#endif
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef EtaPhiGrid_h
+#define EtaPhiGrid_h
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// Per-event bin index of objects in eta-phi. Build() sorts the objects into cells once
+// (counting sort, O(n)); Visit() then only looks at the cells overlapping a cone.
+// Objects beyond etaMax go to the first or last eta row, so nothing is lost.
+class EtaPhiGrid {
+public:
+  EtaPhiGrid(float _etaMax=5.0, float _cellSize=0.2) { SetBinning(_etaMax, _cellSize); }
+
+  void SetBinning(float _etaMax, float _cellSize) {
+    etaMax = _etaMax;
+    nEta = std::max(1, (int)std::ceil(2*etaMax/_cellSize));
+    nPhi = std::max(1, (int)std::floor(2*M_PI/_cellSize));
+    etaSize = 2*etaMax/nEta;
+    phiSize = 2*M_PI/nPhi;
+  }
+
+  // Index the objects with keep[i]!=0 (all objects if keep is null)
+  template <typename T>
+  void Build(const std::vector<T> &eta, const std::vector<T> &phi, const std::vector<char> *keep=0) {
+    int n = eta.size();
+    cellOf.resize(n);
+    start.assign(nEta*nPhi+1, 0);
+    for (int i=0; i<n; i++) {
+      cellOf[i] = (keep && !(*keep)[i]) ? -1 : Cell(EtaBin(eta[i]), PhiBin(phi[i]));
+      if (cellOf[i]>=0) start[cellOf[i]+1]++;
+    }
+    for (unsigned int c=1; c<start.size(); c++) start[c] += start[c-1];
+    items.resize(start.back());
+    std::vector<int> fill(start.begin(), start.end()-1);
+    for (int i=0; i<n; i++) {
+      if (cellOf[i]>=0) items[fill[cellOf[i]]++] = i;
+    }
+  }
+
+  // Call f(index) for every object in the cells within radius of (eta, phi).
+  // This is a superset of the cone: the caller still applies its own dR cut.
+  template <typename F>
+  void Visit(float eta, float phi, float radius, F f) const {
+    if (items.empty()) return;
+    int eta0 = EtaBin(eta-radius), eta1 = EtaBin(eta+radius);
+    int phiSpan = (int)std::ceil(radius/phiSize);
+    int phiC = PhiBin(phi);
+    int phi0 = phiC - phiSpan, phi1 = phiC + phiSpan;
+    if (phi1-phi0+1 >= nPhi) { phi0 = 0; phi1 = nPhi-1; }
+    for (int ie=eta0; ie<=eta1; ie++) {
+      for (int ip=phi0; ip<=phi1; ip++) {
+        int c = Cell(ie, (ip%nPhi + nPhi)%nPhi);
+        for (int k=start[c]; k<start[c+1]; k++) f(items[k]);
+      }
+    }
+  }
+
+  static float DeltaR2(float eta1, float phi1, float eta2, float phi2) {
+    float dphi = std::fabs(phi1-phi2);
+    if (dphi>M_PI) dphi = 2*M_PI - dphi;
+    float deta = eta1-eta2;
+    return deta*deta + dphi*dphi;
+  }
+
+private:
+  float etaMax, etaSize, phiSize;
+  int nEta, nPhi;
+  std::vector<int> cellOf, start, items;
+
+  int Cell(int ie, int ip) const { return ie*nPhi + ip; }
+  int EtaBin(float eta) const {
+    int ie = (int)std::floor((eta+etaMax)/etaSize);
+    return ie<0 ? 0 : (ie>=nEta ? nEta-1 : ie);
+  }
+  int PhiBin(float phi) const {
+    int ip = (int)std::floor((phi+M_PI)/phiSize);
+    return (ip%nPhi + nPhi)%nPhi;
+  }
+};
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef FlatDataset_h
+#define FlatDataset_h
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Fixed-layout columnar export of a dataset, meant to be mmap'ed by fit jobs.
+// Layout: FlatHeader, nColumns x FlatColumn, then one array of doubles per column,
+// each starting at a multiple of FlatHeader::alignment, then the category labels as
+// text lines "column<TAB>index<TAB>label". Little-endian, as written. Needs no ROOT to read.
+// Version 1 files ("WDSFLAT1") have no category columns and no labels; the version is also the
+// last character of the magic, so a reader that only knows "WDSFLAT1" rejects newer files.
+
+struct FlatHeader {         // 64 bytes
+  char     magic[8];        // "WDSFLAT" and the version digit
+  uint32_t version;
+  uint32_t nColumns;
+  uint64_t nRows;
+  uint32_t alignment;
+  uint32_t labelsSize;      // bytes of category labels, 0 without labels
+  uint64_t labelsOffset;    // bytes from the start of the file
+  char     reserved[24];
+};
+
+struct FlatColumn {         // 128 bytes
+  char     name[32];
+  char     title[48];
+  char     unit[16];
+  double   min, max;        // range of the RooRealVar, or of the category indices
+  uint64_t offset;          // bytes from the start of the file
+  uint32_t type;            // kFlatDouble or kFlatCategory (index stored as a double)
+  char     reserved[4];
+};
+
+static_assert(sizeof(FlatHeader)==64, "FlatHeader layout");
+static_assert(sizeof(FlatColumn)==128, "FlatColumn layout");
+
+static const char     kFlatMagic[8] = {'W','D','S','F','L','A','T','2'};
+static const uint32_t kFlatVersion = 2;
+static const uint32_t kFlatAlignment = 64;
+enum FlatColumnType { kFlatDouble=0, kFlatCategory=1 };
+
+typedef std::vector< std::pair<int, std::string> > FlatLabels;     // index and label of each category type
+
+
+class FlatDatasetWriter {
+public:
+  std::vector<FlatColumn> columns;
+  std::vector< std::vector<double> > data;
+
+  int AddColumn(const char *name, const char *title, const char *unit, double min, double max) {
+    FlatColumn column;
+    memset(&column, 0, sizeof(column));
+    strncpy(column.name, name, sizeof(column.name)-1);
+    strncpy(column.title, title, sizeof(column.title)-1);
+    strncpy(column.unit, unit, sizeof(column.unit)-1);
+    column.min = min;
+    column.max = max;
+    columns.push_back(column);
+    data.push_back(std::vector<double>());
+    return columns.size()-1;
+  }
+
+  int AddCategory(const char *name, const char *title, const FlatLabels &labels) {
+    double min = 0, max = 0;
+    for (unsigned int idx=0; idx<labels.size(); idx++) {
+      if (idx==0 || labels[idx].first<min) min = labels[idx].first;
+      if (idx==0 || labels[idx].first>max) max = labels[idx].first;
+    }
+    int col = AddColumn(name, title, "", min, max);
+    columns[col].type = kFlatCategory;
+    for (unsigned int idx=0; idx<labels.size(); idx++) {
+      std::ostringstream line;
+      line << columns[col].name << '\t' << labels[idx].first << '\t' << labels[idx].second << '\n';
+      labelText += line.str();
+    }
+    return col;
+  }
+
+  bool Write(const char *path) {
+    FlatHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kFlatMagic, sizeof(header.magic));
+    header.version = kFlatVersion;
+    header.nColumns = columns.size();
+    header.nRows = data.empty() ? 0 : data[0].size();
+    header.alignment = kFlatAlignment;
+
+    uint64_t offset = Align(sizeof(FlatHeader) + columns.size()*sizeof(FlatColumn));
+    for (unsigned int col=0; col<columns.size(); col++) {
+      if (data[col].size()!=header.nRows) return false;
+      columns[col].offset = offset;
+      offset = Align(offset + header.nRows*sizeof(double));
+    }
+    if (!labelText.empty()) {
+      header.labelsOffset = offset;
+      header.labelsSize = labelText.size();
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file)==1;
+    if (!columns.empty()) ok = ok && fwrite(&columns[0], sizeof(FlatColumn), columns.size(), file)==columns.size();
+    for (unsigned int col=0; col<columns.size() && ok; col++) {
+      ok = Pad(file, columns[col].offset);
+      if (header.nRows) ok = ok && fwrite(&data[col][0], sizeof(double), header.nRows, file)==header.nRows;
+    }
+    ok = ok && Pad(file, offset);
+    if (!labelText.empty()) ok = ok && fwrite(labelText.data(), 1, labelText.size(), file)==labelText.size();
+    return (fclose(file)==0) && ok;
+  }
+
+private:
+  std::string labelText;
+
+  static uint64_t Align(uint64_t offset) {
+    return (offset + kFlatAlignment - 1) / kFlatAlignment * kFlatAlignment;
+  }
+
+  static bool Pad(FILE *file, uint64_t offset) {
+    static const char zeros[kFlatAlignment] = {0};
+    long pos = ftell(file);
+    return pos>=0 && ((uint64_t)pos>=offset || fwrite(zeros, 1, offset-pos, file)==offset-pos);
+  }
+};
+
+
+// Zero-copy reader: the whole file is mapped read-only and shared between processes
+class FlatDatasetReader {
+public:
+  std::string error;
+
+  FlatDatasetReader() : fBase(0), fSize(0) {}
+  ~FlatDatasetReader() { Close(); }
+
+  bool Open(const char *path) {
+    Close();
+    int fd = open(path, O_RDONLY);
+    if (fd<0) return Fail(std::string("Cannot open ") + path);
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size<sizeof(FlatHeader)) {
+      close(fd);
+      return Fail(std::string("Not a flat dataset: ") + path);
+    }
+    void *base = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base==MAP_FAILED) return Fail(std::string("Cannot map ") + path);
+    fBase = (const char*)base;
+    fSize = st.st_size;
+
+    const FlatHeader *header = Header();
+    if (memcmp(header->magic, kFlatMagic, sizeof(kFlatMagic)-1) || header->version<1 || header->version>kFlatVersion ||
+        header->magic[sizeof(kFlatMagic)-1]!=char('0'+header->version) ||
+        sizeof(FlatHeader) + header->nColumns*sizeof(FlatColumn) > fSize) {
+      Close();
+      return Fail(std::string("Not a flat dataset: ") + path);
+    }
+    for (unsigned int col=0; col<header->nColumns; col++) {
+      if (Column(col).offset + header->nRows*sizeof(double) > fSize) {
+        Close();
+        return Fail(std::string("Truncated flat dataset: ") + path);
+      }
+    }
+    if (header->version>=2 && header->labelsSize && header->labelsOffset + header->labelsSize > fSize) {
+      Close();
+      return Fail(std::string("Truncated flat dataset: ") + path);
+    }
+    return true;
+  }
+
+  void Close() {
+    if (fBase) munmap((void*)fBase, fSize);
+    fBase = 0;
+    fSize = 0;
+  }
+
+  uint64_t Rows() const { return Header()->nRows; }
+  int Columns() const { return Header()->nColumns; }
+
+  const FlatColumn& Column(int col) const {
+    return ((const FlatColumn*)(fBase + sizeof(FlatHeader)))[col];
+  }
+
+  int Find(const char *name) const {
+    for (int col=0; col<Columns(); col++) {
+      if (!strncmp(Column(col).name, name, sizeof(Column(col).name))) return col;
+    }
+    return -1;
+  }
+
+  const double* Data(int col) const {
+    return (const double*)(fBase + Column(col).offset);
+  }
+
+  bool IsCategory(int col) const { return Header()->version>=2 && Column(col).type==kFlatCategory; }
+
+  // Types of a category column, in the order they were written
+  FlatLabels Labels(int col) const {
+    FlatLabels labels;
+    if (!IsCategory(col)) return labels;
+    std::string name(Column(col).name, strnlen(Column(col).name, sizeof(Column(col).name)));
+    std::istringstream text(std::string(fBase + Header()->labelsOffset, Header()->labelsSize));
+    std::string line;
+    while (std::getline(text, line)) {
+      std::string::size_type tab1 = line.find('\t'), tab2 = line.find('\t', tab1+1);
+      if (tab2==std::string::npos || line.compare(0, tab1, name)!=0 || tab1!=name.size()) continue;
+      labels.push_back(std::make_pair(atoi(line.substr(tab1+1, tab2-tab1-1).c_str()), line.substr(tab2+1)));
+    }
+    return labels;
+  }
+
+private:
+  const char *fBase;
+  size_t fSize;
+
+  const FlatHeader* Header() const { return (const FlatHeader*)fBase; }
+  bool Fail(const std::string &message) { error = message; return false; }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef GenMatch_h
+#define GenMatch_h
+
+#include <vector>
+#include <cmath>
+
+#include <Rtypes.h>
+
+#include "EtaPhiGrid.h"
+
+// Matching of reco muons to gen muons by dR, through an eta-phi grid of the gen muons.
+// The ntuple has no mother index, so the W origin of a gen muon is a heuristic:
+// the event has a gen W of the same charge, or a muon neutrino of the matching sign
+// with mT(mu, nu) above minWMt.
+class GenMatcher {
+public:
+  enum Mother { kNoMatch=0, kMuon=1, kWDaughter=2 };
+
+  float maxDR;              // largest dR of a match
+  float minWMt;             // mT of the mu-nu pair to call the muon a W daughter
+  float etaAcceptance;      // gen W muons counted for the efficiency
+
+  GenMatcher(float _maxDR=0.1) : maxDR(_maxDR), minWMt(40), etaAcceptance(2.4), grid(5.0, 0.2),
+                                   genPt(0), genEta(0), genPhi(0) {}
+
+  // Index the gen muons of the event; returns the number of W daughters in the acceptance
+  template <typename Event>
+  int SetEvent(const Event &evt) {
+    if (!evt.genPDGId || !evt.genPt || !evt.genEta || !evt.genPhi) {
+      genPt = genEta = genPhi = &none;
+      grid.Build(none, none);
+      return 0;
+    }
+    const std::vector<Int_t> &pdg = *evt.genPDGId;
+    const std::vector<Float_t> &pt = *evt.genPt, &eta = *evt.genEta, &phi = *evt.genPhi;
+    int n = pdg.size();
+    isMuon.assign(n, 0);
+    fromW.assign(n, 0);
+    genPt = &pt;
+    genEta = &eta;
+    genPhi = &phi;
+
+    bool hasW[2] = {false, false};    // W-, W+
+    neutrinos.clear();
+    for (int i=0; i<n; i++) {
+      if (pdg[i]==24) hasW[1] = true;
+      else if (pdg[i]==-24) hasW[0] = true;
+      else if (std::abs(pdg[i])==13) isMuon[i] = 1;
+      else if (std::abs(pdg[i])==14) neutrinos.push_back(i);
+    }
+
+    int nWInAcceptance = 0;
+    for (int i=0; i<n; i++) {
+      if (!isMuon[i]) continue;
+      bool positive = pdg[i]<0;         // mu+ is -13, from W+ with a nu_mu (14)
+      fromW[i] = hasW[positive];
+      for (unsigned int k=0; k<neutrinos.size() && !fromW[i]; k++) {
+        int j = neutrinos[k];
+        if (pdg[j]!=(positive ? 14 : -14)) continue;
+        float mt2 = 2*pt[i]*pt[j]*(1-std::cos(phi[i]-phi[j]));
+        fromW[i] = mt2>minWMt*minWMt;
+      }
+      if (fromW[i] && std::fabs(eta[i])<etaAcceptance) nWInAcceptance++;
+    }
+
+    grid.Build(eta, phi, &isMuon);
+    return nWInAcceptance;
+  }
+
+  // Closest gen muon within maxDR: writes gen pt, dR and the Mother flag (0, 0, kNoMatch without a match)
+  void Match(float eta, float phi, Float_t *out) const {
+    int best = -1;
+    float bestDR2 = maxDR*maxDR;
+    grid.Visit(eta, phi, maxDR, [&](int i) {
+      float dr2 = EtaPhiGrid::DeltaR2(eta, phi, (*genEta)[i], (*genPhi)[i]);
+      if (dr2<bestDR2) { bestDR2 = dr2; best = i; }
+    });
+    out[0] = best<0 ? 0 : (*genPt)[best];
+    out[1] = best<0 ? -1 : std::sqrt(bestDR2);
+    out[2] = best<0 ? kNoMatch : (fromW[best] ? kWDaughter : kMuon);
+  }
+
+private:
+  EtaPhiGrid grid;
+  std::vector<char> isMuon, fromW;
+  std::vector<int> neutrinos;
+  std::vector<Float_t> none;
+  const std::vector<Float_t> *genPt, *genEta, *genPhi;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef InputCheck_h
+#define InputCheck_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TLeaf.h>
+
+// Outcome of opening one input file
+class InputStatus {
+public:
+  std::string path;
+  Long64_t entries;
+  std::string error;        // empty if the file is usable
+
+  InputStatus(const std::string &_path="") : path(_path), entries(-1) {}
+};
+
+
+// Type of a branch as in PFTreeBranchTypes(): class name of object branches, else type of the first leaf
+inline std::string BranchType(TBranch *branch) {
+  std::string type = branch->GetClassName();
+  if (type!="") return type;
+  TObjArray *leaves = branch->GetListOfLeaves();
+  TLeaf *leaf = leaves && leaves->GetEntriesFast()>0 ? (TLeaf*)leaves->At(0) : 0;
+  return leaf ? leaf->GetTypeName() : "";
+}
+
+
+// Open the file, look for the tree and its branches with their types, and close it again
+inline void CheckInputFile(InputStatus &status, const std::string &treeName, const std::map<std::string, std::string> &branches) {
+  TFile *file = TFile::Open(status.path.c_str());
+  if (!file || file->IsZombie()) {
+    status.error = "cannot open file";
+  } else if (file->TestBit(TFile::kRecovered)) {
+    status.error = "file was not closed properly";
+  } else {
+    TTree *tree = dynamic_cast<TTree*>(file->Get(treeName.c_str()));
+    if (!tree) status.error = "no tree " + treeName;
+    else {
+      std::string missing, types;
+      for (std::map<std::string, std::string>::const_iterator it=branches.begin(); it!=branches.end(); ++it) {
+        TBranch *branch = tree->GetBranch(it->first.c_str());
+        if (!branch) missing += (missing=="" ? "missing branches: " : ", ") + it->first;
+        else if (BranchType(branch)!=it->second) {
+          types += (types=="" ? "wrong branch types: " : ", ") + it->first + " is " + BranchType(branch) + " not " + it->second;
+        }
+      }
+      status.error = missing + (missing!="" && types!="" ? "; " : "") + types;
+      status.entries = tree->GetEntries();
+    }
+  }
+  delete file;
+}
+
+
+// Check all files on nThreads threads; each file is opened exactly once
+inline void CheckInputFiles(std::vector<InputStatus> &files, const std::string &treeName,
+                            const std::map<std::string, std::string> &branches, int nThreads) {
+  if (files.empty()) return;
+  if (nThreads>(int)files.size()) nThreads = files.size();
+  if (nThreads<=1) {
+    for (unsigned int idx=0; idx<files.size(); idx++) CheckInputFile(files[idx], treeName, branches);
+    return;
+  }
+
+  ROOT::EnableThreadSafety();
+  std::atomic<unsigned int> next(0);
+  std::vector<std::thread> threads;
+  for (int t=0; t<nThreads; t++) {
+    threads.push_back(std::thread([&]() {
+      for (unsigned int idx=next++; idx<files.size(); idx=next++) CheckInputFile(files[idx], treeName, branches);
+    }));
+  }
+  for (int t=0; t<nThreads; t++) threads[t].join();
+}
+
+#endif
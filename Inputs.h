@@ -2,15 +2,63 @@
 #include <string>
 #include <vector>
 #include <cstdlib>
+#include <cstdio>
 #include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <glob.h>
+
+#include "PFConeIso.h"
+#include "DimuonPairs.h"
+#include "BinnedHists.h"
+#include "Categories.h"
+#include "IsoScan.h"
+#include "DatasetStream.h"
+
+// Selection variant given with -S as isoCut:cutValue[:trigBit[+trigBit...]]
+struct SelectionSpec {
+  int isoCut;
+  float cutValue;
+  std::vector<int> trigBits;
+};
 
 class Inputs {
   public:
     std::vector<std::string> sources;
     std::string outputname;
+    std::string cacheDir;
+    std::string flatname;
+    std::string indexFile;
     bool doMC;
     bool doWeight;
     int  isoCut;
+    float cutValue;
+    std::vector<int> trigBits;
+    std::vector<SelectionSpec> selections;
+    bool activeOnly;
+    bool incremental;
+    bool stagedRead;
+    bool perfStats;
+    int  cacheMB;
+    int  cacheLearn;
+    bool prefetch;
+    int  nThreads;
+    int  nProcs;
+    int  filesPerTask;
+    int  batchSize;
+    int  chunkRows;
+    long long firstEntry;
+    long long nEvents;
+    int  shard;
+    int  nShards;
+    float genDR;
+    std::string pfVetoes;
+    std::string zWindow;
+    std::string binned;
+    std::string etaEdges;
+    std::string categories;
+    std::string isoScan;
+    std::string stream;
 
     int argc;
     char **argv;
@@ -19,7 +67,12 @@ class Inputs {
     Inputs(int argc, char **argv);
     void ShowUsage(std::string argv);
     int ParseOptions();
+    int CheckOptions();
     void ShowOptions();
+    static bool AddSources(std::string source, std::vector<std::string> &sources);
+    static bool ParseIsoCut(const std::string &text, int &isoCut);
+    static std::vector<int> ParseIntList(std::string list);
+    static bool ParseSelections(std::string list, std::vector<SelectionSpec> &specs);
 };
 
 Inputs::Inputs(int _argc, char **_argv) {
@@ -28,11 +81,60 @@ Inputs::Inputs(int _argc, char **_argv) {
     doMC = false;
     doWeight = false;
     isoCut = 0;
+    cutValue = 0.1;
+    trigBits.push_back(5);
+    activeOnly = false;
+    incremental = false;
+    stagedRead = false;
+    perfStats = false;
+    cacheMB = -1;
+    cacheLearn = 0;
+    prefetch = false;
+    nThreads = 1;
+    nProcs = 1;
+    filesPerTask = 1;
+    batchSize = 0;
+    chunkRows = 100000;
+    firstEntry = 0;
+    nEvents = -1;
+    shard = 0;
+    nShards = 1;
+    genDR = 0.1;
+    pfVetoes = "1:0.0001,4:0.01,5:0.01";
     indices.push_back("-i");
     indices.push_back("-o");
     indices.push_back("-m");
     indices.push_back("-w");
     indices.push_back("-c");
+    indices.push_back("-v");
+    indices.push_back("-t");
+    indices.push_back("-S");
+    indices.push_back("-b");
+    indices.push_back("-s");
+    indices.push_back("-j");
+    indices.push_back("-p");
+    indices.push_back("-f");
+    indices.push_back("-B");
+    indices.push_back("-R");
+    indices.push_back("-k");
+    indices.push_back("-a");
+    indices.push_back("-F");
+    indices.push_back("-P");
+    indices.push_back("-C");
+    indices.push_back("-L");
+    indices.push_back("-A");
+    indices.push_back("-I");
+    indices.push_back("--shard");
+    indices.push_back("--first");
+    indices.push_back("--nevents");
+    indices.push_back("-g");
+    indices.push_back("-X");
+    indices.push_back("-Z");
+    indices.push_back("-H");
+    indices.push_back("-E");
+    indices.push_back("-G");
+    indices.push_back("-T");
+    indices.push_back("-O");
     indices.push_back("-h");
 }
 
@@ -41,6 +143,47 @@ void Inputs::ShowOptions() {
             << " doMC\t\t\t" << doMC << std::endl
             << " doWeight\t\t" << doWeight << std::endl
             << " isoCut\t\t\t" << isoCut << std::endl
+            << " cutValue\t\t" << cutValue << std::endl
+            << " trigBits\t\t";
+  for (unsigned int i=0; i<trigBits.size(); i++) {
+    std::cout << (i ? "," : "") << trigBits[i];
+  }
+  std::cout << std::endl;
+  for (unsigned int i=0; i<selections.size(); i++) {
+    std::cout << " selection\t\tisoCut " << selections[i].isoCut << ", cutValue " << selections[i].cutValue
+              << ", trigBits ";
+    for (unsigned int j=0; j<selections[i].trigBits.size(); j++) {
+      std::cout << (j ? "," : "") << selections[i].trigBits[j];
+    }
+    if (selections[i].trigBits.empty()) std::cout << "from -t";
+    std::cout << std::endl;
+  }
+  std::cout << " activeOnly\t\t" << activeOnly << std::endl
+            << " stagedRead\t\t" << stagedRead << std::endl
+            << " perfStats\t\t" << perfStats << std::endl
+            << " cacheMB\t\t" << cacheMB << std::endl
+            << " cacheLearn\t\t" << cacheLearn << std::endl
+            << " prefetch\t\t" << prefetch << std::endl
+            << " indexFile\t\t" << indexFile << std::endl
+            << " firstEntry\t\t" << firstEntry << std::endl
+            << " nEvents\t\t" << nEvents << std::endl
+            << " shard\t\t\t" << shard << "/" << nShards << std::endl
+            << " genDR\t\t\t" << genDR << std::endl
+            << " pfVetoes\t\t" << pfVetoes << std::endl
+            << " zWindow\t\t" << zWindow << std::endl
+            << " binned\t\t" << binned << std::endl
+            << " etaEdges\t\t" << etaEdges << std::endl
+            << " categories\t\t" << categories << std::endl
+            << " isoScan\t\t" << isoScan << std::endl
+            << " stream\t\t\t" << stream << std::endl
+            << " nThreads\t\t" << nThreads << std::endl
+            << " nProcs\t\t\t" << nProcs << std::endl
+            << " filesPerTask\t\t" << filesPerTask << std::endl
+            << " batchSize\t\t" << batchSize << std::endl
+            << " chunkRows\t\t" << chunkRows << std::endl
+            << " cacheDir\t\t" << cacheDir << std::endl
+            << " incremental\t\t" << incremental << std::endl
+            << " Flat output file\t" << flatname << std::endl
             << " Output file\t\t" << outputname << std::endl;
   std::cout << " Input files\n";
   for (unsigned int i=0; i<sources.size(); i++) {
@@ -53,11 +196,40 @@ void Inputs::ShowUsage(std::string argv)
 {
    std::cerr << "Usage: " << argv << " -i input1.root input2.root -o output.root\n"
              << "Options:\n"
-             << "  -i\tName of input files\n"
+             << "  -i\tName of input files, also @filelist.txt (one file per line) and wildcards\n"
              << "  -o\tName of output file\n"
              << "  -w\tApply weight (Default: 0)\n"
              << "  -m\tIs this MC file? (Default: 0)\n"
-             << "  -c\tIsolation cut type (Default: 13)\n"
+             << "  -c\tIsolation cut type; 6X/7X: PF candidates in a cone of 0.X, raw/Vs-subtracted (Default: 13)\n"
+             << "  -v\tIsolation cut value (Default: 0.1)\n"
+             << "  -t\tComma-separated trigger bits, any of them is accepted (Default: 5)\n"
+             << "  -S\tSelections filled in one pass, one dataset each: isoCut:cutValue[:bit+bit],...\n"
+             << "  -b\tRead only branches used by the selection (Default: 0)\n"
+             << "  -s\tStaged read: trigger/ID pre-filter before other branches (Default: 0)\n"
+             << "  -j\tNumber of threads for the event loop (Default: 1)\n"
+             << "  -p\tNumber of worker processes, one task per file group (Default: 1)\n"
+             << "  -f\tNumber of input files per worker task (Default: 1)\n"
+             << "  -B\tMuons per batched (SIMD) isolation evaluation, 0 to disable (Default: 0)\n"
+             << "  -R\tRows moved into the RooDataSet per block, and per flush to the file with -O (Default: 100000)\n"
+             << "  -k\tDirectory of muon-level skim caches, reused while inputs are unchanged (Default: none)\n"
+             << "  -a\tAppend only new or modified input files to the existing output (Default: 0)\n"
+             << "  -F\tAlso write the dataset as a flat mmap-able column file (Default: none)\n"
+             << "  -P\tAttach TTreePerfStats to the input chain and store it in the output (Default: 0)\n"
+             << "  -C\tTTreeCache size in MB, 0 to disable (Default: ROOT default)\n"
+             << "  -L\tEntries for the cache to learn the branches read, 0 to register the active branches (Default: 0)\n"
+             << "  -A\tAsynchronous prefetching and unzipping of the next baskets (Default: 0)\n"
+             << "  -I\tIndex of validated input files and their entries, skips checking unchanged files (Default: none)\n"
+             << "  --shard\tProcess part k/N of the entries, k from 0 to N-1; merge with MergeShards (Default: 0/1)\n"
+             << "  --first\tFirst entry of the input chain to process (Default: 0)\n"
+             << "  --nevents\tNumber of entries to process, -1 for all (Default: -1)\n"
+             << "  -g\tMaximum dR of the reco-gen muon match with -m 1 (Default: 0.1)\n"
+             << "  -X\tPF types summed by -c 6X/7X with their inner veto cones, type:dR,... (Default: 1:0.0001,4:0.01,5:0.01)\n"
+             << "  -Z\tOpposite-charge dimuon Z window, veto:min:max drops the event, flag:min:max adds PairMass/ZFlag (Default: none)\n"
+             << "  -H\tTMass/MET histograms per eta bin and charge, both|only[:nMass:nMET], only drops the dataset (Default: none, bins 80:50)\n"
+             << "  -E\tComma-separated eta bin edges of the -H histograms, -G categories and -T scan (Default: -2.4,-1.6,-0.8,0,0.8,1.6,2.4)\n"
+             << "  -G\tRooCategory column of charge, eta and CentBin bins, column|split[:centrality edges], split also writes one dataset per category (Default: none)\n"
+             << "  -T\tIsolation threshold scan of all tree isolation types in one pass, nBins:maxIso[:tmass|met:cut] (Default: none)\n"
+             << "  -O\tStream the datasets into the output file while reading, algo:level[:basketKB], algo zlib|lzma|lz4|zstd (Default: none)\n"
              << "  -h\tShow this help message\n"
              << std::endl;
 }
@@ -83,7 +255,10 @@ int Inputs::ParseOptions() {
         multipleInput = false;  // Next input argument is a different input option
       else multipleInput = true;
       if (i+1<argc && multipleInput) { // Make sure that this is not the end of argv!
-        sources.push_back(nextArgu);
+        if (!AddSources(nextArgu, sources)) {
+          std::cerr << "Cannot read input file list " << nextArgu.substr(1) << std::endl;
+          return 1;
+        }
       }
 
     } else if (argu=="-o") {
@@ -109,16 +284,395 @@ int Inputs::ParseOptions() {
       }
     } else if (argu=="-c") {
       if (i+1<argc) { // Make sure that this is not the end of argv!
-        isoCut = atoi(nextArgu.c_str());
+        if (!ParseIsoCut(nextArgu, isoCut)) {
+          std::cerr << "-c isolation type must be 0, 13, 14, 15, 2, 21, 3, 6X or 7X." << std::endl;
+          return 1;
+        }
       } else { // Uh-oh, there was no argument to the destination option.
         std::cerr << "-c option requires 1 argument." << std::endl;
         return 1;
       }
+    } else if (argu=="-v") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        cutValue = atof(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-v option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-t") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        trigBits = ParseIntList(nextArgu);
+        for (unsigned int j=0; j<trigBits.size(); j++) {
+          if (trigBits[j]<0 || trigBits[j]>63) {
+            std::cerr << "-t trigger bits must be between 0 and 63." << std::endl;
+            return 1;
+          }
+        }
+        if (trigBits.empty()) {
+          std::cerr << "-t option requires at least 1 trigger bit." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-t option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-S") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        if (!ParseSelections(nextArgu, selections)) {
+          std::cerr << "-S expects isoCut:cutValue[:trigBit[+trigBit...]],... with the isoCut types of -c." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-S option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-b") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        activeOnly = atoi(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-b option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-s") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        stagedRead = atoi(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-s option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-j") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        nThreads = atoi(nextArgu.c_str());
+        if (nThreads<1) nThreads = 1;
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-j option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-p") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        nProcs = atoi(nextArgu.c_str());
+        if (nProcs<1) nProcs = 1;
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-p option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-f") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        filesPerTask = atoi(nextArgu.c_str());
+        if (filesPerTask<1) filesPerTask = 1;
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-f option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-B") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        batchSize = atoi(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-B option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-R") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        chunkRows = atoi(nextArgu.c_str());
+        if (chunkRows<1) chunkRows = 1;
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-R option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-k") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        cacheDir = nextArgu;
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-k option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-a") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        incremental = atoi(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-a option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-F") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        flatname = nextArgu;
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-F option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-P") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        perfStats = atoi(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-P option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-C") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        cacheMB = atoi(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-C option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-L") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        cacheLearn = atoi(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-L option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-A") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        prefetch = atoi(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-A option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-I") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        indexFile = nextArgu;
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-I option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="--shard") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        if (sscanf(nextArgu.c_str(), "%d/%d", &shard, &nShards)!=2 || nShards<1 || shard<0 || shard>=nShards) {
+          std::cerr << "--shard expects k/N with 0 <= k < N." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "--shard option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="--first") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        firstEntry = atoll(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "--first option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="--nevents") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        nEvents = atoll(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "--nevents option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-g") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        genDR = atof(nextArgu.c_str());
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-g option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-X") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        pfVetoes = nextArgu;
+        float veto[PFConeIso::kNPFTypes];
+        if (!PFConeIso::ParseVetoes(pfVetoes, veto)) {
+          std::cerr << "-X expects type:dR,... with PF types 0 to " << PFConeIso::kNPFTypes-1 << "." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-X option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-Z") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        zWindow = nextArgu;
+        int mode;
+        float massMin, massMax;
+        if (!DimuonPairs::Parse(zWindow, mode, massMin, massMax)) {
+          std::cerr << "-Z expects veto:min:max or flag:min:max." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-Z option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-H") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        binned = nextArgu;
+        int mode, nMass, nMET;
+        if (!BinnedHists::Parse(binned, mode, nMass, nMET)) {
+          std::cerr << "-H expects both|only[:nMass:nMET]." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-H option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-E") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        etaEdges = nextArgu;
+        std::vector<double> edges;
+        if (!ParseBinEdges(etaEdges, edges)) {
+          std::cerr << "-E expects increasing comma-separated eta edges." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-E option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-G") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        categories = nextArgu;
+        int mode;
+        std::vector<double> centEdges;
+        if (!CategoryScheme::Parse(categories, mode, centEdges)) {
+          std::cerr << "-G expects column|split[:centrality edges]." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-G option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-T") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        isoScan = nextArgu;
+        int nBins, region;
+        float maxIso, regionCut;
+        if (!IsoScan::Parse(isoScan, nBins, maxIso, region, regionCut)) {
+          std::cerr << "-T expects nBins:maxIso[:tmass|met:cut]." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-T option requires 1 argument." << std::endl;
+        return 1;
+      }
+    } else if (argu=="-O") {
+      if (i+1<argc) { // Make sure that this is not the end of argv!
+        stream = nextArgu;
+        int algorithm, level, basketSize;
+        if (!DatasetStream::Parse(stream, algorithm, level, basketSize)) {
+          std::cerr << "-O expects algo:level[:basketKB], algo zlib or lzma, lz4 from ROOT 6.12, zstd from ROOT 6.20, level 0 to 9." << std::endl;
+          return 1;
+        }
+      } else { // Uh-oh, there was no argument to the destination option.
+        std::cerr << "-O option requires 1 argument." << std::endl;
+        return 1;
+      }
     }
 
   }
 
+  return CheckOptions();
+}
+
+// Combinations of options that cannot work together
+int Inputs::CheckOptions() {
+  bool ranged = nShards>1 || firstEntry>0 || nEvents>=0;
+  int binnedMode = BinnedHists::kOff, nMass, nMET;
+  BinnedHists::Parse(binned, binnedMode, nMass, nMET);
+  int categoryMode = CategoryScheme::kOff;
+  std::vector<double> centEdges;
+  CategoryScheme::Parse(categories, categoryMode, centEdges);
+
+  if (incremental && (!selections.empty() || nProcs>1 || ranged || flatname!="")) {
+    std::cerr << "-a cannot be combined with -S, -p, -F, --shard, --first or --nevents." << std::endl;
+    return 1;
+  }
+  if (nProcs>1 && !selections.empty()) {
+    std::cerr << "-S cannot be combined with -p." << std::endl;
+    return 1;
+  }
+  if (nProcs>1 && ranged) {
+    std::cerr << "--shard, --first and --nevents cannot be combined with -p." << std::endl;
+    return 1;
+  }
+  if (batchSize>0 && !selections.empty()) {
+    std::cerr << "-B cannot be combined with -S." << std::endl;
+    return 1;
+  }
+  if (binnedMode!=BinnedHists::kOff && (incremental || nProcs>1)) {
+    std::cerr << "-H cannot be combined with -a or -p." << std::endl;
+    return 1;
+  }
+  if (categoryMode==CategoryScheme::kSplit && (incremental || nProcs>1)) {
+    std::cerr << "-G split cannot be combined with -a or -p." << std::endl;
+    return 1;
+  }
+  if (isoScan!="" && (incremental || nProcs>1 || !selections.empty() || (isoCut!=0 && IsoBatch::IsoIndex(isoCut)<0))) {
+    std::cerr << "-T cannot be combined with -a, -p, -S or -c other than 0, 13, 14, 15, 2, 21 and 3." << std::endl;
+    return 1;
+  }
+  if (stream!="" && (incremental || nProcs>1 || nThreads>1 || flatname!="")) {
+    // Threads and processes hold their rows until they are merged; -F reads the whole dataset back
+    std::cerr << "-O cannot be combined with -a, -p, -j or -F." << std::endl;
+    return 1;
+  }
+  if (stream!="" && binnedMode==BinnedHists::kOnly) {
+    std::cerr << "-O cannot be combined with -H only, which writes no dataset." << std::endl;
+    return 1;
+  }
   return 0;
 }
 
+// Input file, @list of input files, or wildcard pattern expanded in sorted order
+bool Inputs::AddSources(std::string source, std::vector<std::string> &sources) {
+  if (source.size()>1 && source[0]=='@') {
+    std::ifstream list(source.substr(1).c_str());
+    if (!list) return false;
+    std::string line;
+    while (std::getline(list, line)) {
+      std::istringstream fields(line);
+      std::string path;
+      if (!(fields >> path) || path[0]=='#') continue;
+      if (path[0]=='@' || !AddSources(path, sources)) return false;
+    }
+    return true;
+  }
 
+  glob_t matches;
+  if (source.find_first_of("*?[")!=std::string::npos && glob(source.c_str(), 0, 0, &matches)==0) {
+    for (size_t idx=0; idx<matches.gl_pathc; idx++) sources.push_back(matches.gl_pathv[idx]);
+    globfree(&matches);
+    return true;
+  }
+  sources.push_back(source);      // also patterns without a match, reported when opened
+  return true;
+}
+
+// Isolation types: 0 (none), 13, 14, 15, 2, 21, 3 or a PF cone 6X/7X
+bool Inputs::ParseIsoCut(const std::string &text, int &isoCut) {
+  char *end;
+  long value = strtol(text.c_str(), &end, 10);
+  if (end==text.c_str() || *end || value<0 || value>99) return false;
+  if (value!=0 && IsoBatch::IsoIndex(value)<0 && !PFConeIso::IsConeType(value)) return false;
+  isoCut = value;
+  return true;
+}
+
+std::vector<int> Inputs::ParseIntList(std::string list) {
+  std::vector<int> values;
+  std::replace(list.begin(), list.end(), ',', ' ');
+  std::istringstream stream(list);
+  int value;
+  while (stream >> value) values.push_back(value);
+  if (!stream.eof()) values.clear();        // leftovers such as 5,x
+  return values;
+}
+
+bool Inputs::ParseSelections(std::string list, std::vector<SelectionSpec> &specs) {
+  std::replace(list.begin(), list.end(), ',', ' ');
+  std::istringstream stream(list);
+  std::string item;
+  while (stream >> item) {
+    std::replace(item.begin(), item.end(), ':', ' ');
+    std::istringstream fields(item);
+    SelectionSpec spec;
+    std::string iso, bits;
+    if (!(fields >> iso >> spec.cutValue) || !ParseIsoCut(iso, spec.isoCut)) return false;
+    if (fields >> bits) {
+      std::replace(bits.begin(), bits.end(), '+', ',');
+      spec.trigBits = ParseIntList(bits);
+      if (spec.trigBits.empty()) return false;
+      for (unsigned int j=0; j<spec.trigBits.size(); j++) {
+        if (spec.trigBits[j]<0 || spec.trigBits[j]>63) return false;
+      }
+    }
+    specs.push_back(spec);
+  }
+  return !specs.empty();
+}
@@ -0,0 +1,196 @@
+#ifndef IsoBatch_h
+#define IsoBatch_h
+
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ISOBATCH_AVX2
+#endif
+
+// Structure-of-arrays buffer of muon candidates, evaluated for all isolation types at once.
+// Relative isolation values are computed exactly as in TreeToDataset::CheckIsolation()
+// (same float operations in the same order), so the pass bits match the scalar code.
+class IsoBatch {
+public:
+  enum IsoType { kIso13=0, kIso14, kIso15, kIso2, kIso21, kIso3, kNIsoTypes };
+
+  unsigned int types;       // bit mask of IsoType to fill and evaluate
+
+  // Candidate kinematics
+  std::vector<float> pt, eta;
+  // Isolation inputs
+  std::vector<float> iso03_sumPt, iso03_emEt, iso03_hadEt;
+  std::vector<float> iso04_sumPt, iso04_emEt, iso04_hadEt;
+  std::vector<float> iso05_sumPt, iso05_emEt, iso05_hadEt;
+  std::vector<float> chargedHadronPt, neutralHadronEt, photonEt, dBetaIso, trackIso;
+
+  // Results of Evaluate()
+  std::vector<float> relIso[kNIsoTypes];
+  std::vector<unsigned char> mask;  // bit IsoType set if the candidate passes that cut
+
+  IsoBatch(unsigned int _types=(1<<kNIsoTypes)-1) { types = _types; }
+
+  static int IsoIndex(int isoCut) {
+    switch (isoCut) {
+      case 13: return kIso13;
+      case 14: return kIso14;
+      case 15: return kIso15;
+      case 2:  return kIso2;
+      case 21: return kIso21;
+      case 3:  return kIso3;
+      default: return -1;
+    }
+  }
+
+  bool Has(int type) const { return types & (1<<type); }
+  int  Size() const { return (int)pt.size(); }
+  void Clear();
+  void Evaluate(const float cutValue[kNIsoTypes]);
+
+private:
+  static bool UseAVX2();
+  static void Sum3Ratio(const float *a, const float *b, const float *c, const float *pt, float *out, int n);
+  static void Ratio(const float *a, const float *pt, float *out, int n);
+  static void PFRatio(const float *ch, const float *nh, const float *ph, const float *pt, float *out, int n);
+  static void PassBits(const float *rel, float cut, int bit, unsigned char *mask, int n);
+#ifdef ISOBATCH_AVX2
+  static void Sum3RatioAVX2(const float *a, const float *b, const float *c, const float *pt, float *out, int n);
+  static void RatioAVX2(const float *a, const float *pt, float *out, int n);
+  static void PFRatioAVX2(const float *ch, const float *nh, const float *ph, const float *pt, float *out, int n);
+  static void PassBitsAVX2(const float *rel, float cut, int bit, unsigned char *mask, int n);
+#endif
+};
+
+
+inline void IsoBatch::Clear() {
+  std::vector<float> *columns[] = { &pt, &eta,
+                                    &iso03_sumPt, &iso03_emEt, &iso03_hadEt,
+                                    &iso04_sumPt, &iso04_emEt, &iso04_hadEt,
+                                    &iso05_sumPt, &iso05_emEt, &iso05_hadEt,
+                                    &chargedHadronPt, &neutralHadronEt, &photonEt, &dBetaIso, &trackIso };
+  for (unsigned int idx=0; idx<sizeof(columns)/sizeof(columns[0]); idx++) columns[idx]->clear();
+  mask.clear();
+}
+
+
+inline void IsoBatch::Evaluate(const float cutValue[kNIsoTypes]) {
+  int n = Size();
+  mask.assign(n, 0);
+  if (n==0) return;
+
+  for (int type=0; type<kNIsoTypes; type++) {
+    if (!Has(type)) continue;
+    relIso[type].resize(n);
+    float *out = &relIso[type][0];
+
+    if (type==kIso13)      Sum3Ratio(&iso03_sumPt[0], &iso03_emEt[0], &iso03_hadEt[0], &pt[0], out, n);
+    else if (type==kIso14) Sum3Ratio(&iso04_sumPt[0], &iso04_emEt[0], &iso04_hadEt[0], &pt[0], out, n);
+    else if (type==kIso15) Sum3Ratio(&iso05_sumPt[0], &iso05_emEt[0], &iso05_hadEt[0], &pt[0], out, n);
+    else if (type==kIso2)  relIso[type].assign(dBetaIso.begin(), dBetaIso.end());
+    else if (type==kIso21) PFRatio(&chargedHadronPt[0], &neutralHadronEt[0], &photonEt[0], &pt[0], out, n);
+    else if (type==kIso3)  Ratio(&trackIso[0], &pt[0], out, n);
+
+    PassBits(&relIso[type][0], cutValue[type], type, &mask[0], n);
+  }
+}
+
+
+inline bool IsoBatch::UseAVX2() {
+#ifdef ISOBATCH_AVX2
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+
+// ===== Scalar kernels =====
+inline void IsoBatch::Sum3Ratio(const float *a, const float *b, const float *c, const float *pt, float *out, int n) {
+#ifdef ISOBATCH_AVX2
+  if (UseAVX2()) return Sum3RatioAVX2(a, b, c, pt, out, n);
+#endif
+  for (int i=0; i<n; i++) out[i] = ( a[i] + b[i] + c[i] ) / pt[i];
+}
+
+inline void IsoBatch::Ratio(const float *a, const float *pt, float *out, int n) {
+#ifdef ISOBATCH_AVX2
+  if (UseAVX2()) return RatioAVX2(a, pt, out, n);
+#endif
+  for (int i=0; i<n; i++) out[i] = a[i] / pt[i];
+}
+
+inline void IsoBatch::PFRatio(const float *ch, const float *nh, const float *ph, const float *pt, float *out, int n) {
+#ifdef ISOBATCH_AVX2
+  if (UseAVX2()) return PFRatioAVX2(ch, nh, ph, pt, out, n);
+#endif
+  for (int i=0; i<n; i++) {
+    float sumEtInCone = ch[i];
+    float Et = nh[i] + ph[i];
+    if (0.<Et) sumEtInCone += Et;
+    out[i] = sumEtInCone / pt[i];
+  }
+}
+
+inline void IsoBatch::PassBits(const float *rel, float cut, int bit, unsigned char *mask, int n) {
+#ifdef ISOBATCH_AVX2
+  if (UseAVX2()) return PassBitsAVX2(rel, cut, bit, mask, n);
+#endif
+  for (int i=0; i<n; i++) mask[i] |= (unsigned char)((rel[i] < cut) << bit);
+}
+
+
+// ===== AVX2 kernels, 8 candidates per step with a scalar tail =====
+#ifdef ISOBATCH_AVX2
+__attribute__((target("avx2")))
+inline void IsoBatch::Sum3RatioAVX2(const float *a, const float *b, const float *c, const float *pt, float *out, int n) {
+  int i = 0;
+  for (; i+8<=n; i+=8) {
+    __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(a+i), _mm256_loadu_ps(b+i)), _mm256_loadu_ps(c+i));
+    _mm256_storeu_ps(out+i, _mm256_div_ps(sum, _mm256_loadu_ps(pt+i)));
+  }
+  for (; i<n; i++) out[i] = ( a[i] + b[i] + c[i] ) / pt[i];
+}
+
+__attribute__((target("avx2")))
+inline void IsoBatch::RatioAVX2(const float *a, const float *pt, float *out, int n) {
+  int i = 0;
+  for (; i+8<=n; i+=8) {
+    _mm256_storeu_ps(out+i, _mm256_div_ps(_mm256_loadu_ps(a+i), _mm256_loadu_ps(pt+i)));
+  }
+  for (; i<n; i++) out[i] = a[i] / pt[i];
+}
+
+__attribute__((target("avx2")))
+inline void IsoBatch::PFRatioAVX2(const float *ch, const float *nh, const float *ph, const float *pt, float *out, int n) {
+  int i = 0;
+  const __m256 zero = _mm256_setzero_ps();
+  for (; i+8<=n; i+=8) {
+    __m256 sumEtInCone = _mm256_loadu_ps(ch+i);
+    __m256 Et = _mm256_add_ps(_mm256_loadu_ps(nh+i), _mm256_loadu_ps(ph+i));
+    __m256 positive = _mm256_cmp_ps(zero, Et, _CMP_LT_OQ);
+    sumEtInCone = _mm256_blendv_ps(sumEtInCone, _mm256_add_ps(sumEtInCone, Et), positive);
+    _mm256_storeu_ps(out+i, _mm256_div_ps(sumEtInCone, _mm256_loadu_ps(pt+i)));
+  }
+  for (; i<n; i++) {
+    float sumEtInCone = ch[i];
+    float Et = nh[i] + ph[i];
+    if (0.<Et) sumEtInCone += Et;
+    out[i] = sumEtInCone / pt[i];
+  }
+}
+
+__attribute__((target("avx2")))
+inline void IsoBatch::PassBitsAVX2(const float *rel, float cut, int bit, unsigned char *mask, int n) {
+  int i = 0;
+  const __m256 cutv = _mm256_set1_ps(cut);
+  for (; i+8<=n; i+=8) {
+    int pass = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(rel+i), cutv, _CMP_LT_OQ));
+    for (int k=0; k<8; k++) mask[i+k] |= (unsigned char)(((pass>>k)&1) << bit);
+  }
+  for (; i<n; i++) mask[i] |= (unsigned char)((rel[i] < cut) << bit);
+}
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef IsoScan_h
+#define IsoScan_h
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+#include <TH1D.h>
+#include <TDirectory.h>
+
+#include "IsoBatch.h"
+
+// Relative isolation of the ID- and trigger-selected muons for every isolation type of the tree,
+// histogrammed per eta bin (and an all-eta slot) and optionally below/above a TMass or MET cut.
+// Write() turns each distribution into the yield and efficiency of the cut "relIso < threshold"
+// at every bin edge, so one pass replaces a run per cutValue.
+class IsoScan {
+public:
+  enum Region { kNone=0, kTMass, kMET };
+
+  int nBins;                // thresholds between 0 and maxIso
+  float maxIso;
+  int region;               // split of the muons by TMass or MET
+  float regionCut;
+  std::vector<double> etaEdges;
+
+  IsoScan() : nBins(0), maxIso(0), region(kNone), regionCut(0) {
+    const double edges[] = {-2.4, -1.6, -0.8, 0, 0.8, 1.6, 2.4};
+    etaEdges.assign(edges, edges+7);
+  }
+  IsoScan(const IsoScan &other) { *this = other; }
+  ~IsoScan() { Clear(); }
+
+  IsoScan &operator=(const IsoScan &other) {
+    if (this==&other) return *this;
+    Clear();
+    nBins = other.nBins;
+    maxIso = other.maxIso;
+    region = other.region;
+    regionCut = other.regionCut;
+    etaEdges = other.etaEdges;
+    for (unsigned int idx=0; idx<other.hists.size(); idx++) {
+      hists.push_back((TH1D*)other.hists[idx]->Clone());
+      hists.back()->SetDirectory(0);
+    }
+    return *this;
+  }
+
+  // nBins:maxIso[:tmass|met:cut]
+  static bool Parse(const std::string &spec, int &nBins, float &maxIso, int &region, float &regionCut) {
+    if (spec=="") { nBins = 0; return true; }
+    std::string item = spec;
+    std::replace(item.begin(), item.end(), ':', ' ');
+    std::istringstream fields(item);
+    int n;
+    float max;
+    if (!(fields >> n >> max) || n<=0 || max<=0) return false;
+    std::string name;
+    float cut;
+    int split = kNone;
+    if (fields >> name) {
+      if (name=="tmass") split = kTMass;
+      else if (name=="met") split = kMET;
+      else return false;
+      if (!(fields >> cut)) return false;
+      regionCut = cut;
+    }
+    nBins = n;
+    maxIso = max;
+    region = split;
+    return true;
+  }
+
+  bool Configure(const std::string &spec) { return Parse(spec, nBins, maxIso, region, regionCut); }
+
+  bool Active() const { return nBins>0; }
+  int  NEtaSlots() const { return etaEdges.size(); }     // eta bins and all eta
+  int  NRegions() const { return region==kNone ? 1 : 2; }
+
+  void Book() {
+    Clear();
+    static const int isoCuts[IsoBatch::kNIsoTypes] = {13, 14, 15, 2, 21, 3};
+    for (int type=0; type<IsoBatch::kNIsoTypes; type++) {
+      for (int ie=0; ie<NEtaSlots(); ie++) {
+        for (int ir=0; ir<NRegions(); ir++) {
+          bool all = ie==NEtaSlots()-1;
+          std::string tag = Form("iso%d_", isoCuts[type]);
+          tag += (all ? std::string("etaAll") : Form("eta%d", ie)) + RegionTag(ir);
+          std::string range = all ? std::string("all #eta") : Form("%g<#eta<%g", etaEdges[ie], etaEdges[ie+1]);
+          TH1D *h = new TH1D(("hIso_"+tag).c_str(), Form("isoCut %d, %s;relative isolation", isoCuts[type], range.c_str()),
+                             nBins, 0, maxIso);
+          h->SetDirectory(0);
+          hists.push_back(h);
+        }
+      }
+    }
+  }
+
+  // Same binning as other, empty; for per-thread copies
+  void BookAs(const IsoScan &other) {
+    nBins = other.nBins;
+    maxIso = other.maxIso;
+    region = other.region;
+    regionCut = other.regionCut;
+    etaEdges = other.etaEdges;
+    if (other.hists.empty()) Clear();
+    else Book();
+  }
+
+  // Candidate i of an evaluated IsoBatch
+  void Fill(const IsoBatch &batch, int i, float mt, float met, float eta) {
+    if (hists.empty()) return;
+    int ir = region==kNone ? 0 : ((region==kTMass ? mt : met) < regionCut ? 0 : 1);
+    int ie = -1;
+    if (eta>=etaEdges.front() && eta<etaEdges.back()) {
+      ie = std::upper_bound(etaEdges.begin(), etaEdges.end(), eta) - etaEdges.begin() - 1;
+    }
+    int all = NEtaSlots()-1;
+    for (int type=0; type<IsoBatch::kNIsoTypes; type++) {
+      float iso = batch.relIso[type][i];
+      if (ie>=0) hists[Index(type, ie, ir)]->Fill(iso);
+      hists[Index(type, all, ir)]->Fill(iso);
+    }
+  }
+
+  void Add(const IsoScan &other) {
+    for (unsigned int idx=0; idx<hists.size() && idx<other.hists.size(); idx++) hists[idx]->Add(other.hists[idx]);
+  }
+
+  // Distributions, yields and efficiencies in the subdirectory name of dir
+  void Write(TDirectory *dir, const std::string &name) const {
+    if (hists.empty()) return;
+    TDirectory *sub = dir->GetDirectory(name.c_str());
+    if (!sub) sub = dir->mkdir(name.c_str());
+    sub->cd();
+    for (unsigned int idx=0; idx<hists.size(); idx++) {
+      TH1D *h = hists[idx];
+      std::string tag = std::string(h->GetName()).substr(5);
+      TH1D *yield = new TH1D(("hYield_"+tag).c_str(), Form("%s;relative isolation threshold;muons below", h->GetTitle()),
+                             nBins, 0, maxIso);
+      TH1D *eff = new TH1D(("hEff_"+tag).c_str(), Form("%s;relative isolation threshold;efficiency", h->GetTitle()),
+                           nBins, 0, maxIso);
+      yield->SetDirectory(0);
+      eff->SetDirectory(0);
+      // Bin b holds the muons with relIso below its upper edge, negative values included
+      double total = h->GetEntries();
+      double below = h->GetBinContent(0);
+      for (int b=1; b<=nBins; b++) {
+        below += h->GetBinContent(b);
+        yield->SetBinContent(b, below);
+        yield->SetBinError(b, std::sqrt(below));
+        double e = total>0 ? below/total : 0;
+        eff->SetBinContent(b, e);
+        eff->SetBinError(b, total>0 ? std::sqrt(e*(1-e)/total) : 0);
+      }
+      h->Write(0, TObject::kOverwrite);
+      yield->Write(0, TObject::kOverwrite);
+      eff->Write(0, TObject::kOverwrite);
+      delete yield;
+      delete eff;
+    }
+    dir->cd();
+  }
+
+private:
+  std::vector<TH1D*> hists; // [type][eta slot][region]
+
+  int Index(int type, int ie, int ir) const { return (type*NEtaSlots() + ie)*NRegions() + ir; }
+
+  std::string RegionTag(int ir) const {
+    if (region==kNone) return "";
+    return std::string(region==kTMass ? "_tmass" : "_met") + (ir==0 ? "Below" : "Above");
+  }
+
+  void Clear() {
+    for (unsigned int idx=0; idx<hists.size(); idx++) delete hists[idx];
+    hists.clear();
+  }
+};
+
+#endif
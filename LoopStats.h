@@ -0,0 +1,163 @@
+#ifndef LoopStats_h
+#define LoopStats_h
+
+#include <string>
+#include <iostream>
+#include <chrono>
+
+#include <TNamed.h>
+#include <TDirectory.h>
+#include <TTreePerfStats.h>
+
+// Adds the time spent in its scope to a counter, optionally taking it off another one
+class ScopedTimer {
+public:
+  ScopedTimer(double &_total, double *_exclude=0) : total(_total), exclude(_exclude), start(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    total += elapsed;
+    if (exclude) *exclude -= elapsed;
+  }
+
+private:
+  double &total;
+  double *exclude;
+  std::chrono::steady_clock::time_point start;
+};
+
+
+// Cut flow and time per stage of the event loop. One instance per thread, summed at the end.
+// In the multi-selection mode the trigger and tight counts are shared, counted once per event and
+// muon; a muon counts as isolated once if any selection accepts it, and accepted once per selection.
+class LoopStats {
+public:
+  Long64_t nEvents;         // events read
+  Long64_t nTriggered;      // events passing the event-level trigger
+  Long64_t nZEvents;        // events with a candidate muon and an opposite-charge dimuon in the Z window
+  Long64_t nMuons;          // muons in triggered events
+  Long64_t nTight;
+  Long64_t nTrigMatched;
+  Long64_t nIsolated;
+  Long64_t nAccepted;       // rows filled into the dataset(s)
+
+  // Gen matching with doMC
+  Long64_t nGenW;           // gen W muons in the acceptance, in all events read
+  Long64_t nMatched;        // accepted rows matched to any gen muon
+  Long64_t nMatchedW;       // accepted rows matched to a W muon
+  double tRead;             // GetEntry / staged reads
+  double tSelect;           // selection of the muons, without tFill
+  double tFill;             // rows moved into the RooDataSet store
+  double tWall;             // whole Loop(), only for the main instance
+
+  // I/O of the main chain, from TTreePerfStats when attached
+  Long64_t bytesRead;
+  Long64_t readCalls;
+  double tUnzip;
+  double tDisk;
+
+  // TTreeCache hit efficiencies, summed over the files read
+  double cacheEfficiency, cacheEfficiencyRel;
+  int cacheFiles;
+
+  LoopStats() { Clear(); }
+
+  void Clear() {
+    nEvents = nTriggered = nZEvents = nMuons = nTight = nTrigMatched = nIsolated = nAccepted = 0;
+    nGenW = nMatched = nMatchedW = 0;
+    tRead = tSelect = tFill = tWall = 0;
+    bytesRead = readCalls = 0;
+    tUnzip = tDisk = 0;
+    cacheEfficiency = cacheEfficiencyRel = 0;
+    cacheFiles = 0;
+  }
+
+  void Add(const LoopStats &other) {
+    nEvents += other.nEvents;
+    nTriggered += other.nTriggered;
+    nZEvents += other.nZEvents;
+    nMuons += other.nMuons;
+    nTight += other.nTight;
+    nTrigMatched += other.nTrigMatched;
+    nIsolated += other.nIsolated;
+    nAccepted += other.nAccepted;
+    nGenW += other.nGenW;
+    nMatched += other.nMatched;
+    nMatchedW += other.nMatchedW;
+    tRead += other.tRead;
+    tSelect += other.tSelect;
+    tFill += other.tFill;
+    cacheEfficiency += other.cacheEfficiency;
+    cacheEfficiencyRel += other.cacheEfficiencyRel;
+    cacheFiles += other.cacheFiles;
+  }
+
+  void SetPerfStats(const TTreePerfStats *perf) {
+    if (!perf) return;
+    bytesRead = perf->GetBytesRead();
+    readCalls = (Long64_t)perf->GetReadCalls();
+    tUnzip = perf->GetUnzipTime();
+    tDisk = perf->GetDiskTime();
+  }
+
+  void Print(std::ostream &out) const {
+    out << "Cut flow" << std::endl
+        << "  events read\t\t" << nEvents << std::endl
+        << "  trigger passed\t" << nTriggered << Percent(nTriggered, nEvents) << std::endl;
+    if (nZEvents>0) out << "  dimuon in Z window\t" << nZEvents << Percent(nZEvents, nTriggered) << std::endl;
+    out << "  muons\t\t\t" << nMuons << std::endl
+        << "  tight\t\t\t" << nTight << Percent(nTight, nMuons) << std::endl
+        << "  trigger matched\t" << nTrigMatched << Percent(nTrigMatched, nTight) << std::endl
+        << "  isolated\t\t" << nIsolated << Percent(nIsolated, nTrigMatched) << std::endl
+        << "  accepted\t\t" << nAccepted << std::endl;
+    if (nGenW>0 || nMatched>0) {
+      out << "Gen matching" << std::endl
+          << "  gen W muons\t\t" << nGenW << std::endl
+          << "  matched to W muon\t" << nMatchedW << std::endl
+          << "  efficiency\t\t" << Ratio(nMatchedW, nGenW) << std::endl
+          << "  purity\t\t" << Ratio(nMatchedW, nAccepted) << std::endl
+          << "  any gen muon\t\t" << Ratio(nMatched, nAccepted) << std::endl;
+    }
+    double tStages = tRead + tSelect + tFill;
+    out << "Timing (summed over threads)" << std::endl
+        << "  read\t\t" << tRead << " s" << Percent(tRead, tStages) << std::endl
+        << "  selection\t" << tSelect << " s" << Percent(tSelect, tStages) << std::endl
+        << "  fill\t\t" << tFill << " s" << Percent(tFill, tStages) << std::endl;
+    if (tWall>0) {
+      out << "  wall\t\t" << tWall << " s, " << nEvents/tWall << " events/s, "
+          << nAccepted/tWall << " candidates/s" << std::endl;
+    }
+    if (readCalls>0) {
+      out << "I/O: " << bytesRead/1048576. << " MB in " << readCalls << " read calls, "
+          << "disk " << tDisk << " s, unzip " << tUnzip << " s" << std::endl;
+    }
+    if (cacheFiles>0) {
+      out << "TTreeCache efficiency " << cacheEfficiency/cacheFiles << ", relative "
+          << cacheEfficiencyRel/cacheFiles << " (mean of " << cacheFiles << " files)" << std::endl;
+    }
+  }
+
+  std::string Json() const {
+    return Form("{\"events\": %lld, \"triggered\": %lld, \"zWindow\": %lld, \"muons\": %lld, \"tight\": %lld, \"trigMatched\": %lld, "
+                "\"isolated\": %lld, \"accepted\": %lld, \"genW\": %lld, \"matched\": %lld, \"matchedW\": %lld, \"readSeconds\": %g, \"selectSeconds\": %g, "
+                "\"fillSeconds\": %g, \"wallSeconds\": %g, \"bytesRead\": %lld, \"readCalls\": %lld, "
+                "\"diskSeconds\": %g, \"unzipSeconds\": %g, \"cacheEfficiency\": %g, \"cacheEfficiencyRel\": %g}",
+                nEvents, nTriggered, nZEvents, nMuons, nTight, nTrigMatched, nIsolated, nAccepted,
+                nGenW, nMatched, nMatchedW, tRead, tSelect, tFill, tWall, bytesRead, readCalls, tDisk, tUnzip,
+                cacheFiles ? cacheEfficiency/cacheFiles : 0., cacheFiles ? cacheEfficiencyRel/cacheFiles : 0.);
+  }
+
+  // Stored as a TNamed "loopStats" whose title is the JSON summary
+  void Write(TDirectory *dir) const {
+    dir->cd();
+    TNamed stats("loopStats", Json().c_str());
+    stats.Write("loopStats", TObject::kOverwrite);
+  }
+
+private:
+  static double Ratio(double num, double den) { return den>0 ? num/den : 0; }
+  static std::string Percent(double num, double den) {
+    return den>0 ? Form("\t(%.1f%%)", 100.*num/den) : "";
+  }
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef Manifest_h
+#define Manifest_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TDirectory.h>
+#include <TSystem.h>
+#include <TMD5.h>
+
+// One input file already processed into the output dataset
+class ManifestEntry {
+public:
+  std::string path;
+  std::string checksum;     // md5 of the file content, once it was needed (see Checksum())
+  Long64_t size;
+  Long64_t mtime;
+  Long64_t entries;         // entries of the input tree
+  Long64_t firstRow;        // rows [firstRow, firstRow+nRows) of the dataset come from this file
+  Long64_t nRows;
+
+  ManifestEntry() : size(-1), mtime(-1), entries(0), firstRow(0), nRows(0) {}
+};
+
+
+// List of processed input files, stored as the "manifest" tree of the output file.
+// Entry paths are canonical (see Stat() and Read()); new entries go through Add().
+class Manifest {
+public:
+  std::vector<ManifestEntry> files;
+
+  int Find(const std::string &path) const {
+    std::map<std::string, size_t>::const_iterator found = byPath.find(Canonical(path));
+    return found==byPath.end() ? -1 : (int)found->second;
+  }
+
+  void Add(const ManifestEntry &entry) {
+    byPath[entry.path] = files.size();
+    files.push_back(entry);
+  }
+
+  // Absolute path without symlinks, ./ and ../, so one file has one path; unchanged if it does not exist
+  static std::string Canonical(const std::string &path) {
+    char *resolved = realpath(path.c_str(), 0);
+    if (!resolved) return path;
+    std::string canonical = resolved;
+    free(resolved);
+    return canonical;
+  }
+
+  // Size and modification time, without opening the file
+  static bool Stat(const std::string &path, ManifestEntry &entry) {
+    FileStat_t stat;
+    if (gSystem->GetPathInfo(path.c_str(), stat)) return false;
+    entry.path = Canonical(path);
+    entry.size = stat.fSize;
+    entry.mtime = stat.fMtime;
+    return true;
+  }
+
+  // Description of a file to process: also opens it for the tree entries
+  static bool Stamp(const std::string &path, const char *treeName, ManifestEntry &entry) {
+    if (!Stat(path, entry)) return false;
+    TFile *file = TFile::Open(path.c_str());
+    if (!file || file->IsZombie()) {
+      delete file;
+      return false;
+    }
+    TTree *tree = dynamic_cast<TTree*>(file->Get(treeName));
+    entry.entries = tree ? tree->GetEntries() : 0;
+    delete file;
+    return tree!=0;
+  }
+
+  // Reads the whole file: only for a file with a new modification time but the same size,
+  // since a file rewritten in place keeps its UUID and often its size
+  static bool Checksum(const std::string &path, ManifestEntry &entry) {
+    TMD5 *md5 = TMD5::FileChecksum(path.c_str());
+    if (!md5) return false;
+    entry.checksum = md5->AsString();
+    delete md5;
+    return true;
+  }
+
+  void Read(TDirectory *dir) {
+    files.clear();
+    byPath.clear();
+    TTree *tree = dynamic_cast<TTree*>(dir->Get("manifest"));
+    if (!tree) return;
+
+    ManifestEntry entry;
+    std::string *path = 0, *checksum = 0;
+    tree->SetBranchAddress("path", &path);
+    tree->SetBranchAddress("checksum", &checksum);
+    tree->SetBranchAddress("size", &entry.size);
+    tree->SetBranchAddress("mtime", &entry.mtime);
+    tree->SetBranchAddress("entries", &entry.entries);
+    tree->SetBranchAddress("firstRow", &entry.firstRow);
+    tree->SetBranchAddress("nRows", &entry.nRows);
+    for (Long64_t idx=0; idx<tree->GetEntries(); idx++) {
+      tree->GetEntry(idx);
+      entry.path = Canonical(*path);
+      entry.checksum = *checksum;
+      Add(entry);
+    }
+    delete tree;
+    delete path;
+    delete checksum;
+  }
+
+  void Write(TDirectory *dir) {
+    dir->cd();
+    TTree *tree = new TTree("manifest","Input files processed into the dataset");
+    ManifestEntry entry;
+    tree->Branch("path", &entry.path);
+    tree->Branch("checksum", &entry.checksum);
+    tree->Branch("size", &entry.size, "size/L");
+    tree->Branch("mtime", &entry.mtime, "mtime/L");
+    tree->Branch("entries", &entry.entries, "entries/L");
+    tree->Branch("firstRow", &entry.firstRow, "firstRow/L");
+    tree->Branch("nRows", &entry.nRows, "nRows/L");
+    for (unsigned int idx=0; idx<files.size(); idx++) {
+      entry = files[idx];
+      tree->Fill();
+    }
+    tree->Write("manifest", TObject::kOverwrite);
+    delete tree;
+  }
+
+private:
+  std::map<std::string, size_t> byPath;     // index in files of each canonical path
+};
+
+#endif
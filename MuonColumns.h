@@ -0,0 +1,68 @@
+#ifndef MuonColumns_h
+#define MuonColumns_h
+
+#include <string>
+#include <vector>
+
+#include "IsoBatch.h"
+#include "RowArena.h"
+
+// Tight, trigger-matched muons of the whole input kept in memory for repeated selections:
+// the dataset row of each muon, its trigger bits and its relative isolation for every
+// isolation type stored in the tree. A selection is then a pass over these columns.
+class MuonColumns {
+public:
+  RowArena rows;                    // row of TreeToDataset::MakeRow(), muon charge last
+  std::vector<ULong64_t> trigBits;  // muTrig&HLTriggers of each muon
+  std::vector<float> relIso[IsoBatch::kNIsoTypes];
+  ULong64_t trigMask;               // triggers the muons were loaded for
+
+  MuonColumns() : trigMask(0) {}
+
+  unsigned int Size() const { return trigBits.size(); }
+
+  // Evaluate the isolation of the collected candidates and append them with their rows
+  void Append(IsoBatch &batch, RowArena &batchRows) {
+    float cuts[IsoBatch::kNIsoTypes] = {0};
+    batch.Evaluate(cuts);
+    for (int type=0; type<IsoBatch::kNIsoTypes; type++) {
+      if (batch.Has(type)) relIso[type].insert(relIso[type].end(), batch.relIso[type].begin(), batch.relIso[type].end());
+    }
+    rows.Append(batchRows);
+    batch.Clear();
+    batchRows.Clear();
+  }
+
+  // Give back the reserve of the column vectors once loading is done
+  void Shrink() {
+    for (unsigned int col=0; col<rows.columns.size(); col++) std::vector<Float_t>(rows.columns[col]).swap(rows.columns[col]);
+    std::vector<ULong64_t>(trigBits).swap(trigBits);
+    for (int type=0; type<IsoBatch::kNIsoTypes; type++) std::vector<float>(relIso[type]).swap(relIso[type]);
+  }
+
+  double MB() const {
+    double bytes = trigBits.capacity()*sizeof(ULong64_t);
+    for (unsigned int col=0; col<rows.columns.size(); col++) bytes += rows.columns[col].capacity()*sizeof(Float_t);
+    for (int type=0; type<IsoBatch::kNIsoTypes; type++) bytes += relIso[type].capacity()*sizeof(float);
+    return bytes/1048576.;
+  }
+
+  // Indices of the muons passing the trigger mask and the isolation cut, in input order.
+  // Returns an error for triggers or isolation types that were not loaded.
+  std::string Select(ULong64_t mask, int isoCut, float cutValue, std::vector<unsigned int> &selected) const {
+    selected.clear();
+    if (mask==0 || (mask&~trigMask)!=0) return "trigger bits not loaded by the server";
+    int type = IsoBatch::IsoIndex(isoCut);
+    if (isoCut!=0 && (type<0 || relIso[type].size()!=Size())) return "isolation type not available from the loaded columns";
+    if (Size()==0) return "";
+    const float *iso = isoCut==0 ? 0 : relIso[type].data();
+    for (unsigned int i=0; i<Size(); i++) {
+      if ( (trigBits[i]&mask)==0 ) continue;
+      if ( iso && !(iso[i] < cutValue) ) continue;
+      selected.push_back(i);
+    }
+    return "";
+  }
+};
+
+#endif
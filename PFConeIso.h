@@ -0,0 +1,123 @@
+#ifndef PFConeIso_h
+#define PFConeIso_h
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+#include <Rtypes.h>
+
+#include "EtaPhiGrid.h"
+
+// Muon isolation computed from the PF candidates, for cone sizes not stored in the tree.
+// isoCut 6X is the raw pt sum in a cone of 0.X, 7X the same with the Vs-subtracted pfVsPt.
+// The PF candidates of an event are binned once in eta-phi; the first query of the event
+// then sums all muons and all cones in one pass over the cells around each muon.
+class PFConeIso {
+public:
+  enum { kNPFTypes = 8 };   // reco::PFCandidate::ParticleType: X, h, e, mu, gamma, h0, h_HF, egamma_HF
+
+  PFConeIso() : grid(5.0, 0.2), nMuons(0), computed(false) { SetVetoes("1:0.0001,4:0.01,5:0.01"); }
+
+  static bool IsConeType(int isoCut) { return (isoCut/10==6 || isoCut/10==7) && isoCut%10>0; }
+  static float ConeSize(int isoCut) { return 0.1f*(isoCut%10); }
+  static bool Subtracted(int isoCut) { return isoCut/10==7; }
+
+  // Candidate types summed, each with its own inner veto cone: type:dR,...
+  // veto[type] is -1 for the types not summed
+  static bool ParseVetoes(const std::string &spec, float *veto) {
+    std::fill(veto, veto+kNPFTypes, -1.f);
+    std::stringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+      int type = -1;
+      float dr = -1;
+      char colon = 0;
+      std::stringstream fields(item);
+      if (!(fields >> type >> colon >> dr) || colon!=':' || type<0 || type>=kNPFTypes || dr<0) return false;
+      veto[type] = dr;
+    }
+    return true;
+  }
+
+  bool SetVetoes(const std::string &spec) {
+    float veto[kNPFTypes];
+    if (!ParseVetoes(spec, veto)) return false;
+    vetoSpec = spec;
+    for (int type=0; type<kNPFTypes; type++) vetoDR2[type] = veto[type]<0 ? -1 : veto[type]*veto[type];
+    return true;
+  }
+  const std::string &Vetoes() const { return vetoSpec; }
+
+  // Register the cone of an isoCut type; all registered cones are filled together
+  void AddCone(int isoCut) {
+    if (!IsConeType(isoCut)) return;
+    float size = ConeSize(isoCut);
+    if (std::find(cones.begin(), cones.end(), size)!=cones.end()) return;
+    cones.push_back(size);
+    std::sort(cones.begin(), cones.end());
+  }
+
+  void NewEvent() { computed = false; }
+
+  // Relative isolation of muon i_mu for an isoCut type registered with AddCone()
+  template <typename Event>
+  float RelIso(const Event &evt, int i_mu, int isoCut) {
+    if (!computed) Compute(evt);
+    int cone = std::find(cones.begin(), cones.end(), ConeSize(isoCut)) - cones.begin();
+    const std::vector<float> &sums = Subtracted(isoCut) ? vsSum : rawSum;
+    return sums[i_mu*cones.size() + cone] / (*evt.muPt)[i_mu];
+  }
+
+private:
+  EtaPhiGrid grid;
+  std::vector<float> cones;         // sorted cone sizes
+  float vetoDR2[kNPFTypes];         // squared inner veto cone, -1 if the type is not summed
+  std::string vetoSpec;
+  int nMuons;
+  bool computed;
+  std::vector<float> rawSum, vsSum; // [muon][cone], cumulative over the cones
+
+  template <typename Event>
+  void Compute(const Event &evt) {
+    computed = true;
+    nMuons = evt.muPt->size();
+    int nCones = cones.size();
+    rawSum.assign(nMuons*nCones, 0);
+    vsSum.assign(nMuons*nCones, 0);
+    if (nCones==0 || !evt.pfId || !evt.pfPt || !evt.pfEta || !evt.pfPhi) return;
+
+    const std::vector<Int_t> &id = *evt.pfId;
+    const std::vector<Float_t> &pt = *evt.pfPt, &eta = *evt.pfEta, &phi = *evt.pfPhi;
+    const std::vector<Float_t> *vsPt = evt.pfVsPt;
+    if (vsPt && vsPt->size()!=pt.size()) vsPt = 0;
+    grid.Build(eta, phi);
+
+    std::vector<float> cone2(nCones);
+    for (int c=0; c<nCones; c++) cone2[c] = cones[c]*cones[c];
+    float maxCone = cones.back();
+
+    for (int i_mu=0; i_mu<nMuons; i_mu++) {
+      float muEta = (*evt.muEta)[i_mu], muPhi = (*evt.muPhi)[i_mu];
+      float *raw = &rawSum[i_mu*nCones], *vs = &vsSum[i_mu*nCones];
+      // Sum each candidate into the smallest cone containing it, then accumulate outwards
+      grid.Visit(muEta, muPhi, maxCone, [&](int i) {
+        int type = id[i];
+        if (type<0 || type>=kNPFTypes || vetoDR2[type]<0) return;
+        float dr2 = EtaPhiGrid::DeltaR2(muEta, muPhi, eta[i], phi[i]);
+        if (dr2<vetoDR2[type] || dr2>=cone2[nCones-1]) return;
+        int c = std::upper_bound(cone2.begin(), cone2.end(), dr2) - cone2.begin();
+        raw[c] += pt[i];
+        if (vsPt) vs[c] += (*vsPt)[i];
+      });
+      for (int c=1; c<nCones; c++) {
+        raw[c] += raw[c-1];
+        vs[c] += vs[c-1];
+      }
+    }
+  }
+};
+
+#endif
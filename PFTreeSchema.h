@@ -0,0 +1,209 @@
+#ifndef PFTreeSchema_h
+#define PFTreeSchema_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+// Branches of the pfcandAnalyzer tree, one line per branch. The event data members, their
+// null-initialization, the TBranch handles and the binding are all generated from this table.
+// PFTREE_BRANCHES(SCALAR, ARRAY, VECTOR) expands to
+//   SCALAR(type, name)          one value per event
+//   ARRAY(type, name, size)     fixed-size array
+//   VECTOR(type, name, group)   std::vector<type>*, group is the object the vector belongs to
+#define PFTREE_BRANCHES(SCALAR, ARRAY, VECTOR) \
+  SCALAR(UInt_t, runNb) \
+  SCALAR(UInt_t, eventNb) \
+  SCALAR(UInt_t, LS) \
+  /* -- centrality variables -- */ \
+  SCALAR(Int_t, CentBin) \
+  SCALAR(Int_t, Npix) \
+  SCALAR(Int_t, NpixelTracks) \
+  SCALAR(Int_t, Ntracks) \
+  SCALAR(Int_t, NtracksPtCut) \
+  SCALAR(Int_t, NtracksEtaCut) \
+  SCALAR(Int_t, NtracksEtaPtCut) \
+  SCALAR(Float_t, SumET_HF) \
+  SCALAR(Float_t, SumET_HFplus) \
+  SCALAR(Float_t, SumET_HFminus) \
+  SCALAR(Float_t, SumET_HFplusEta4) \
+  SCALAR(Float_t, SumET_HFminusEta4) \
+  SCALAR(Float_t, SumET_HFhit) \
+  SCALAR(Float_t, SumET_HFhitPlus) \
+  SCALAR(Float_t, SumET_HFhitMinus) \
+  SCALAR(Float_t, SumET_ZDC) \
+  SCALAR(Float_t, SumET_ZDCplus) \
+  SCALAR(Float_t, SumET_ZDCminus) \
+  SCALAR(Float_t, SumET_EEplus) \
+  SCALAR(Float_t, SumET_EEminus) \
+  SCALAR(Float_t, SumET_EE) \
+  SCALAR(Float_t, SumET_EB) \
+  SCALAR(Float_t, SumET_ET) \
+  /* -- Primary Vertex -- */ \
+  SCALAR(Float_t, nPV) \
+  SCALAR(Float_t, RefVtx_x) \
+  SCALAR(Float_t, RefVtx_y) \
+  SCALAR(Float_t, RefVtx_z) \
+  SCALAR(Float_t, RefVtx_xError) \
+  SCALAR(Float_t, RefVtx_yError) \
+  SCALAR(Float_t, RefVtx_zError) \
+  /* -- particle flow candidates -- */ \
+  SCALAR(Int_t, nPFpart) \
+  VECTOR(Int_t, pfId, pf) \
+  VECTOR(Float_t, pfPt, pf) \
+  VECTOR(Float_t, pfEnergy, pf) \
+  VECTOR(Float_t, pfVsPt, pf) \
+  VECTOR(Float_t, pfVsPtInitial, pf) \
+  VECTOR(Float_t, pfArea, pf) \
+  VECTOR(Float_t, pfEta, pf) \
+  VECTOR(Float_t, pfPhi, pf) \
+  VECTOR(Int_t, pfCharge, pf) \
+  VECTOR(Float_t, pfTheta, pf) \
+  VECTOR(Float_t, pfEt, pf) \
+  ARRAY(Float_t, vn, 200) \
+  ARRAY(Float_t, psin, 200) \
+  ARRAY(Float_t, sumpt, 20) \
+  /* (particle flow charged hadrons and muons) */ \
+  VECTOR(Float_t, pfMuonPx, pfMu) \
+  VECTOR(Float_t, pfMuonPy, pfMu) \
+  VECTOR(Float_t, pfMuonPz, pfMu) \
+  VECTOR(bool, pfTrackerMuon, pfMu) \
+  VECTOR(Float_t, pfTrackerMuonPt, pfMu) \
+  VECTOR(Int_t, pfTrackHits, pfMu) \
+  VECTOR(Float_t, pfDxy, pfMu) \
+  VECTOR(Float_t, pfDz, pfMu) \
+  VECTOR(Float_t, pfChi2, pfMu) \
+  VECTOR(Float_t, pfGlobalMuonPt, pfMu) \
+  VECTOR(Float_t, pfChargedPx, charged) \
+  VECTOR(Float_t, pfChargedPy, charged) \
+  VECTOR(Float_t, pfChargedPz, charged) \
+  VECTOR(Float_t, pfChargedTrackRefPt, charged) \
+  /* -- GEN info -- */ \
+  SCALAR(Int_t, nGENpart) \
+  VECTOR(Int_t, genPDGId, gen) \
+  VECTOR(Float_t, genPt, gen) \
+  VECTOR(Float_t, genEta, gen) \
+  VECTOR(Float_t, genPhi, gen) \
+  /* -- generalTracks info -- */ \
+  /* track algorithm enum: https://cmssdt.cern.ch/SDT/doxygen/CMSSW_8_0_24/doc/html/da/d0c/TrackBase_8h_source.html#l00099 */ \
+  SCALAR(Int_t, nTRACKpart) \
+  VECTOR(Int_t, traQual, trk) \
+  VECTOR(Int_t, traCharge, trk) \
+  VECTOR(Float_t, traPt, trk) \
+  VECTOR(Float_t, traEta, trk) \
+  VECTOR(Float_t, traPhi, trk) \
+  VECTOR(Int_t, traAlgo, trk) \
+  VECTOR(Int_t, traHits, trk) \
+  /* -- MET info -- */ \
+  SCALAR(Float_t, recoPFMET) \
+  SCALAR(Float_t, recoPFMETPhi) \
+  SCALAR(Float_t, recoPFMETsumEt) \
+  SCALAR(Float_t, recoPFMETmEtSig) \
+  SCALAR(Float_t, recoPFMETSig) \
+  /* -- Muon info (pat::muons) -- */ \
+  SCALAR(Int_t, nMUpart) \
+  VECTOR(Float_t, muPx, mu) \
+  VECTOR(Float_t, muPy, mu) \
+  VECTOR(Float_t, muPz, mu) \
+  VECTOR(Float_t, muMt, mu) \
+  VECTOR(Float_t, muPt, mu) \
+  VECTOR(Float_t, muEta, mu) \
+  VECTOR(Float_t, muPhi, mu) \
+  VECTOR(Int_t, muCharge, mu) \
+  VECTOR(Int_t, muSelectionType, mu) \
+  /* R0.3 default pp isolation setup */ \
+  VECTOR(Float_t, muTrackIso, mu) \
+  VECTOR(Float_t, muCaloIso, mu) \
+  VECTOR(Float_t, muEcalIso, mu) \
+  VECTOR(Float_t, muHcalIso, mu) \
+  /* R0.4 muon POG default PF-based isolation */ \
+  VECTOR(Float_t, muSumChargedHadronPt, mu) \
+  VECTOR(Float_t, muSumNeutralHadronEt, mu) \
+  VECTOR(Float_t, muSumPhotonEt, mu) \
+  VECTOR(Float_t, muSumPUPt, mu) \
+  VECTOR(Float_t, muPFBasedDBetaIso, mu) \
+  VECTOR(bool, muHighPurity, mu) \
+  VECTOR(bool, muIsTightMuon, mu) \
+  VECTOR(bool, muIsGoodMuon, mu) \
+  VECTOR(bool, muTrkMuArb, mu) \
+  VECTOR(bool, muTMOneStaTight, mu) \
+  VECTOR(Int_t, muNTrkHits, mu) \
+  VECTOR(Int_t, muNPixValHits, mu) \
+  VECTOR(Int_t, muNPixWMea, mu) \
+  VECTOR(Int_t, muNTrkWMea, mu) \
+  VECTOR(Int_t, muStationsMatched, mu) \
+  VECTOR(Int_t, muNMuValHits, mu) \
+  VECTOR(Float_t, muDxy, mu) \
+  VECTOR(Float_t, muDxyErr, mu) \
+  VECTOR(Float_t, muDz, mu) \
+  VECTOR(Float_t, muDzErr, mu) \
+  VECTOR(Float_t, muPtInner, mu) \
+  VECTOR(Float_t, muPtErrInner, mu) \
+  VECTOR(Float_t, muPtGlobal, mu) \
+  VECTOR(Float_t, muPtErrGlobal, mu) \
+  VECTOR(Float_t, muNormChi2Inner, mu) \
+  VECTOR(Float_t, muNormChi2Global, mu) \
+  VECTOR(Float_t, muIso03_sumPt, mu) \
+  VECTOR(Float_t, muIso04_sumPt, mu) \
+  VECTOR(Float_t, muIso05_sumPt, mu) \
+  VECTOR(Float_t, muIso03_emEt, mu) \
+  VECTOR(Float_t, muIso04_emEt, mu) \
+  VECTOR(Float_t, muIso05_emEt, mu) \
+  VECTOR(Float_t, muIso03_hadEt, mu) \
+  VECTOR(Float_t, muIso04_hadEt, mu) \
+  VECTOR(Float_t, muIso05_hadEt, mu) \
+  VECTOR(Int_t, muIso03_nTracks, mu) \
+  VECTOR(Int_t, muIso04_nTracks, mu) \
+  VECTOR(Int_t, muIso05_nTracks, mu) \
+  VECTOR(bool, muNotPFMuon, mu) \
+  /* -- Trigger info -- */ \
+  VECTOR(ULong64_t, muTrig, trig) \
+  SCALAR(ULong64_t, HLTriggers) \
+  VECTOR(Int_t, trigPrescale, trig)
+
+
+// Leaf code and stored type name of the branch types in the table
+template <typename T> struct PFTreeType;
+template <> struct PFTreeType<Int_t> {
+  static const char *Code() { return "I"; }
+  static const char *Vector() { return "vector<int>"; }
+};
+template <> struct PFTreeType<UInt_t> {
+  static const char *Code() { return "i"; }
+  static const char *Vector() { return "vector<unsigned int>"; }
+};
+template <> struct PFTreeType<Float_t> {
+  static const char *Code() { return "F"; }
+  static const char *Vector() { return "vector<float>"; }
+};
+template <> struct PFTreeType<ULong64_t> {
+  static const char *Code() { return "l"; }
+  static const char *Vector() { return "vector<ULong64_t>"; }
+};
+template <> struct PFTreeType<bool> {
+  static const char *Code() { return "O"; }
+  static const char *Vector() { return "vector<bool>"; }
+};
+
+
+// Type name of every branch as the tree reports it: leaf type for scalars and arrays, class for vectors
+inline std::map<std::string, std::string> PFTreeMakeBranchTypes() {
+  std::map<std::string, std::string> types;
+#define PFTREE_SCALAR_TYPE(type, name) types[#name] = #type;
+#define PFTREE_ARRAY_TYPE(type, name, size) types[#name] = #type;
+#define PFTREE_VECTOR_TYPE(type, name, group) types[#name] = PFTreeType<type>::Vector();
+  PFTREE_BRANCHES(PFTREE_SCALAR_TYPE, PFTREE_ARRAY_TYPE, PFTREE_VECTOR_TYPE)
+#undef PFTREE_SCALAR_TYPE
+#undef PFTREE_ARRAY_TYPE
+#undef PFTREE_VECTOR_TYPE
+  return types;
+}
+
+inline const std::map<std::string, std::string> &PFTreeBranchTypes() {
+  static const std::map<std::string, std::string> types = PFTreeMakeBranchTypes();
+  return types;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef RowArena_h
+#define RowArena_h
+
+#include <string>
+#include <vector>
+
+#include "RooDataSet.h"
+#include "RooRealVar.h"
+#include "RooCategory.h"
+#include "RooArgSet.h"
+#include "RooAbsDataStore.h"
+
+// Accepted candidates kept as flat float columns and moved into a RooDataSet in blocks.
+// MoveTo() writes straight into the dataset's own row variables and store, which is
+// what RooDataSet::add() ends up doing, without a RooArgList and a by-name copy per row.
+class RowArena {
+public:
+  std::vector<std::string> names;           // one RooRealVar (or RooCategory index) name per column
+  std::vector< std::vector<Float_t> > columns;
+  unsigned int chunkRows;                   // rows reserved per column
+  int splitColumn;                          // MoveTo() also fills split[value of this column], -1 for none
+
+  RowArena(unsigned int _chunkRows=100000) { chunkRows = _chunkRows; splitColumn = -1; }
+
+  void SetColumns(const std::vector<std::string> &_names) {
+    names = _names;
+    columns.assign(names.size(), std::vector<Float_t>());
+    for (unsigned int col=0; col<columns.size(); col++) columns[col].reserve(chunkRows);
+  }
+
+  unsigned int Size() const { return columns.empty() ? 0 : columns[0].size(); }
+
+  int Column(const std::string &name) const {
+    for (unsigned int col=0; col<names.size(); col++) if (names[col]==name) return col;
+    return -1;
+  }
+
+  void Append(const Float_t *row) {
+    for (unsigned int col=0; col<columns.size(); col++) columns[col].push_back(row[col]);
+  }
+
+  // Append all rows of another arena with the same columns
+  void Append(const RowArena &other) {
+    for (unsigned int col=0; col<columns.size(); col++) {
+      columns[col].insert(columns[col].end(), other.columns[col].begin(), other.columns[col].end());
+    }
+  }
+
+  void Clear() {
+    for (unsigned int col=0; col<columns.size(); col++) columns[col].clear();
+  }
+
+  // Fill all rows into the dataset in order and empty the arena.
+  // With splitColumn set, each row is also filled into split[row category].
+  void MoveTo(RooDataSet *data, const std::vector<RooDataSet*> &split=std::vector<RooDataSet*>()) {
+    unsigned int nrows = Size();
+    if (nrows==0) return;
+
+    Target all(data, names);
+    std::vector<Target> parts;
+    if (splitColumn>=0) {
+      for (unsigned int idx=0; idx<split.size(); idx++) parts.push_back(Target(split[idx], names));
+    }
+    for (unsigned int irow=0; irow<nrows; irow++) {
+      all.Fill(columns, irow);
+      if (splitColumn<0) continue;
+      unsigned int part = (unsigned int)columns[splitColumn][irow];
+      if (part<parts.size()) parts[part].Fill(columns, irow);
+    }
+    Clear();
+  }
+
+private:
+  // Row variables and store of one dataset
+  class Target {
+  public:
+    std::vector<RooRealVar*> vars;
+    std::vector<RooCategory*> cats;
+    RooAbsDataStore *store;
+
+    Target(RooDataSet *data, const std::vector<std::string> &names) {
+      const RooArgSet *row = data->get();
+      vars.assign(names.size(), (RooRealVar*)0);
+      cats.assign(names.size(), (RooCategory*)0);
+      for (unsigned int col=0; col<names.size(); col++) {
+        RooAbsArg *arg = row->find(names[col].c_str());
+        vars[col] = dynamic_cast<RooRealVar*>(arg);
+        if (!vars[col]) cats[col] = dynamic_cast<RooCategory*>(arg);
+      }
+      store = data->store();
+      store->checkInit();
+    }
+
+    void Fill(const std::vector< std::vector<Float_t> > &columns, unsigned int irow) {
+      for (unsigned int col=0; col<columns.size(); col++) {
+        if (vars[col]) vars[col]->setVal(columns[col][irow]);
+        else if (cats[col]) cats[col]->setIndex((Int_t)columns[col][irow]);
+      }
+      store->fill();
+    }
+  };
+};
+
+#endif
@@ -4,6 +4,10 @@
 #include <utility>
 #include <math.h>
 #include <fstream>
+#include <cstring>
+#include <thread>
+#include <set>
+#include <map>
 
 #include <TROOT.h>
 #include <TChain.h>
@@ -15,8 +19,30 @@
 #include <TH1D.h>
 #include <TH2D.h>
 #include <TCanvas.h>
+#include <TNamed.h>
+#include <TSystem.h>
+#include <TMD5.h>
+#include <TProcPool.h>
+#include <TEnv.h>
+#include <TTreeCache.h>
+#include <TTreeCacheUnzip.h>
 
 #include "StyleFunc.h"
+#include "IsoBatch.h"
+#include "RowArena.h"
+#include "Manifest.h"
+#include "FlatDataset.h"
+#include "LoopStats.h"
+#include "InputCheck.h"
+#include "PFTreeSchema.h"
+#include "GenMatch.h"
+#include "PFConeIso.h"
+#include "DimuonPairs.h"
+#include "BinnedHists.h"
+#include "Categories.h"
+#include "MuonColumns.h"
+#include "IsoScan.h"
+#include "DatasetStream.h"
 
 #include "RooFit.h"
 #include "RooDataSet.h"
@@ -33,327 +59,207 @@ public:
   // ===== Class Methods =====
   void Init();
 
-  unsigned int runNb;
-  unsigned int eventNb;
-  unsigned int LS;
-
-  // -- centrality variables --
-  Int_t           CentBin;
-  Int_t           Npix, NpixelTracks, Ntracks, NtracksPtCut, NtracksEtaCut, NtracksEtaPtCut;
-  Float_t         SumET_HF, SumET_HFplus, SumET_HFminus, SumET_HFplusEta4, SumET_HFminusEta4;
-  Float_t         SumET_HFhit, SumET_HFhitPlus, SumET_HFhitMinus;
-  Float_t         SumET_ZDC, SumET_ZDCplus, SumET_ZDCminus;
-  Float_t         SumET_EEplus, SumET_EEminus;
-  Float_t         SumET_EE, SumET_EB, SumET_ET;
-
-  // -- Primary Vetex --
-  Float_t         nPV;
-  Float_t         RefVtx_x, RefVtx_y, RefVtx_z;
-  Float_t         RefVtx_xError, RefVtx_yError, RefVtx_zError;
-
-  // -- particle info & GEN info --
-  Int_t                        nPFpart, nGENpart, njets;
-  std::vector<Int_t>           *pfId, *genPDGId;
-  std::vector<Float_t>         *pfEnergy, *jetEnergy;
-  std::vector<Float_t>         *pfPt, *genPt,  *jetPt;
-  std::vector<Float_t>         *pfEta, *genEta,  *jetEta;
-  std::vector<Float_t>         *pfPhi, *genPhi,  *jetPhi;
-  std::vector<Float_t>         *jetMass, *jetPU;
-  std::vector<Int_t>           *jetMatchIndex, *pfCharge;
-  std::vector<Float_t>         *pfTheta, *pfEt;
-  std::vector<Float_t>         *pfVsPt, *pfVsPtInitial, *pfArea;
-  Float_t                      vn[200];
-  Float_t                      psin[200];
-  Float_t                      sumpt[20];
-  Float_t                      ueraw[1200];
-  // (particle flow charged hadrons and muons)
-  std::vector<Float_t>         *pfMuonPx, *pfMuonPy, *pfMuonPz;
-  std::vector<bool>            *pfTrackerMuon;
-  std::vector<Float_t>         *pfTrackerMuonPt;
-  std::vector<Int_t>           *pfTrackHits;
-  std::vector<Float_t>         *pfDxy, *pfDz, *pfChi2;
-  std::vector<Float_t>         *pfGlobalMuonPt;
-  std::vector<Float_t>         *pfChargedPx, *pfChargedPy, *pfChargedPz;
-  std::vector<Float_t>         *pfChargedTrackRefPt;
-
-  // -- generalTracks info --
-  Int_t                        nTRACKpart;
-  std::vector<Int_t>           *traQual, *traCharge;
-  std::vector<Float_t>         *traPt,   *traEta,  *traPhi;
-  std::vector<Int_t>           *traAlgo, *traHits;
-  // track algorithm enum:
-  // https://cmssdt.cern.ch/SDT/doxygen/CMSSW_8_0_24/doc/html/da/d0c/TrackBase_8h_source.html#l00099
-
-  // -- MET info --
-  Float_t                      recoPFMET, recoPFMETPhi, recoPFMETsumEt;
-  Float_t                      recoPFMETmEtSig, recoPFMETSig;
-
-  // -- Muon info (pat::muons) --
-  Int_t                        nMUpart;
-  std::vector<Float_t>         *muPx, *muPy, *muPz;
-  std::vector<Float_t>         *muMt, *muPt, *muEta, *muPhi;
-  std::vector<Int_t>           *muCharge, *mu_SelectionType;
-  std::vector<Float_t>         *muTrackIso, *muCaloIso, *muEcalIso, *muHcalIso; //R0.3 default pp isolation setup
-  std::vector<Float_t>         *muSumChargedHadronPt, *muSumNeutralHadronEt, *muSumPhotonEt, *muSumPUPt, *muPFBasedDBetaIso; //R0.4 (*mu POG default PF-based isolation)
-  std::vector<bool>            *muHighPurity, *muIsTightMuon, *muIsGoodMuon, *muTrkMuArb, *muTMOneStaTight;
-  std::vector<Int_t>           *muSelectionType, *muNTrkHits, *muNPixValHits, *muNPixWMea, *muNTrkWMea, *muStationsMatched, *muNMuValHits;
-  std::vector<Float_t>         *muDxy, *muDxyErr, *muDz, *muDzErr;
-  std::vector<Float_t>         *muPtInner, *muPtErrInner, *muPtGlobal, *muPtErrGlobal;
-  std::vector<Float_t>         *muNormChi2Inner, *muNormChi2Global;
-  std::vector<Float_t>         *muIso03_sumPt, *muIso04_sumPt, *muIso05_sumPt, *muIso03_emEt, *muIso04_emEt, *muIso05_emEt, *muIso03_hadEt, *muIso04_hadEt, *muIso05_hadEt;
-  std::vector<Int_t>           *muIso03_nTracks, *muIso04_nTracks, *muIso05_nTracks;
-  std::vector<bool>            *muNotPFMuon;
-
-  // -- Trigger info --
-  std::vector<ULong64_t>       *muTrig;
-  ULong64_t                    HLTriggers;
-  std::vector<Int_t>           *trigPrescale;
+  // One member per branch of PFTREE_BRANCHES. The vectors are allocated by ROOT when their
+  // branch is bound, so only the branches read take memory.
+#define PFTREE_SCALAR_MEMBER(type, name) type name;
+#define PFTREE_ARRAY_MEMBER(type, name, size) type name[size];
+#define PFTREE_VECTOR_MEMBER(type, name, group) std::vector<type> *name;
+  PFTREE_BRANCHES(PFTREE_SCALAR_MEMBER, PFTREE_ARRAY_MEMBER, PFTREE_VECTOR_MEMBER)
+#undef PFTREE_SCALAR_MEMBER
+#undef PFTREE_ARRAY_MEMBER
+#undef PFTREE_VECTOR_MEMBER
 };
 
 void TreePFCandEventData::Init()
 {
-  pfId = 0;
-  pfPt = 0;
-  pfEnergy = 0;
-  pfVsPt = 0;
-  pfVsPtInitial = 0;
-  pfArea = 0;
-  pfEta = 0;
-  pfPhi = 0;
-  pfCharge = 0;
-  pfTheta = 0;
-  pfEt = 0;
-  pfMuonPx = 0;
-  pfMuonPy = 0;
-  pfMuonPz = 0;
-  pfTrackerMuon = 0;
-  pfTrackerMuonPt = 0;
-  pfTrackHits = 0;
-  pfDxy = 0;
-  pfDz = 0;
-  pfChi2 = 0;
-  pfGlobalMuonPt = 0;
-  pfChargedPx = 0;
-  pfChargedPy = 0;
-  pfChargedPz = 0;
-  pfChargedTrackRefPt = 0;
-  genPDGId = 0;
-  genPt = 0;
-  genEta = 0;
-  genPhi = 0;
-  traQual = 0;
-  traCharge = 0;
-  traPt = 0;
-  traEta = 0;
-  traPhi = 0;
-  traAlgo = 0;
-  traHits = 0;
-  muPx = 0;
-  muPy = 0;
-  muPz = 0;
-  muMt = 0;
-  muPt = 0;
-  muEta = 0;
-  muPhi = 0;
-  muCharge = 0;
-  muSelectionType = 0;
-  muTrackIso = 0;
-  muCaloIso = 0;
-  muEcalIso = 0;
-  muHcalIso = 0;
-  muSumChargedHadronPt = 0;
-  muSumNeutralHadronEt = 0;
-  muSumPhotonEt = 0;
-  muSumPUPt = 0;
-  muPFBasedDBetaIso = 0;
-  muHighPurity = 0;
-  muIsTightMuon = 0;
-  muIsGoodMuon = 0;
-  muTrkMuArb = 0;
-  muTMOneStaTight = 0;
-  muNTrkHits = 0;
-  muNPixValHits = 0;
-  muNPixWMea = 0;
-  muNTrkWMea = 0;
-  muStationsMatched = 0;
-  muNMuValHits = 0;
-  muDxy = 0;
-  muDxyErr = 0;
-  muDz = 0;
-  muDzErr = 0;
-  muPtInner = 0;
-  muPtErrInner = 0;
-  muPtGlobal = 0;
-  muPtErrGlobal = 0;
-  muNormChi2Inner = 0;
-  muNormChi2Global = 0;
-  muIso03_sumPt = 0;
-  muIso04_sumPt = 0;
-  muIso05_sumPt = 0;
-  muIso03_emEt = 0;
-  muIso04_emEt = 0;
-  muIso05_emEt = 0;
-  muIso03_hadEt = 0;
-  muIso04_hadEt = 0;
-  muIso05_hadEt = 0;
-  muIso03_nTracks = 0;
-  muIso04_nTracks = 0;
-  muIso05_nTracks = 0;
-  muNotPFMuon = 0;
-  muTrig = 0;
-  trigPrescale = 0;
+#define PFTREE_SKIP_SCALAR(type, name)
+#define PFTREE_SKIP_ARRAY(type, name, size)
+#define PFTREE_VECTOR_INIT(type, name, group) name = 0;
+  PFTREE_BRANCHES(PFTREE_SKIP_SCALAR, PFTREE_SKIP_ARRAY, PFTREE_VECTOR_INIT)
+#undef PFTREE_SKIP_SCALAR
+#undef PFTREE_SKIP_ARRAY
+#undef PFTREE_VECTOR_INIT
 }
 
 
+// Isolation evaluators, one per isoCut type (see TreeToDataset::CheckIsolation).
+// Vectors are accessed without bounds checks: nMUpart must be validated first.
+template <int ISO>
+inline bool PassIsolation(const TreePFCandEventData &/*evt*/, int /*i_mu*/, float /*cutValue*/) {
+  return false; // unknown isolation type
+}
+
+template <>
+inline bool PassIsolation<0>(const TreePFCandEventData &/*evt*/, int /*i_mu*/, float /*cutValue*/) {
+  return true;
+}
+
+template <>
+inline bool PassIsolation<13>(const TreePFCandEventData &evt, int i_mu, float cutValue) {
+  float sumEtInCone = ( (*evt.muIso03_sumPt)[i_mu] + (*evt.muIso03_emEt)[i_mu] + (*evt.muIso03_hadEt)[i_mu] ) / (*evt.muPt)[i_mu];
+  return sumEtInCone < cutValue;
+}
+
+template <>
+inline bool PassIsolation<14>(const TreePFCandEventData &evt, int i_mu, float cutValue) {
+  float sumEtInCone = ( (*evt.muIso04_sumPt)[i_mu] + (*evt.muIso04_emEt)[i_mu] + (*evt.muIso04_hadEt)[i_mu] ) / (*evt.muPt)[i_mu];
+  return sumEtInCone < cutValue;
+}
+
+template <>
+inline bool PassIsolation<15>(const TreePFCandEventData &evt, int i_mu, float cutValue) {
+  float sumEtInCone = ( (*evt.muIso05_sumPt)[i_mu] + (*evt.muIso05_emEt)[i_mu] + (*evt.muIso05_hadEt)[i_mu] ) / (*evt.muPt)[i_mu];
+  return sumEtInCone < cutValue;
+}
+
+template <>
+inline bool PassIsolation<2>(const TreePFCandEventData &evt, int i_mu, float cutValue) {
+  return (*evt.muPFBasedDBetaIso)[i_mu] < cutValue;
+}
+
+template <>
+inline bool PassIsolation<21>(const TreePFCandEventData &evt, int i_mu, float cutValue) {
+  float sumEtInCone = (*evt.muSumChargedHadronPt)[i_mu];
+  float Et = (*evt.muSumNeutralHadronEt)[i_mu] + (*evt.muSumPhotonEt)[i_mu];
+  if (0.<Et) sumEtInCone += Et;
+  sumEtInCone /= (*evt.muPt)[i_mu];
+  return sumEtInCone < cutValue;
+}
+
+template <>
+inline bool PassIsolation<3>(const TreePFCandEventData &evt, int i_mu, float cutValue) {
+  return (*evt.muTrackIso)[i_mu]/(*evt.muPt)[i_mu] < cutValue;
+}
+
+typedef bool (*IsolationFunc)(const TreePFCandEventData&, int, float);
+
+inline IsolationFunc GetIsolationFunc(int isoCut) {
+  switch (isoCut) {
+    case 0:  return &PassIsolation<0>;
+    case 13: return &PassIsolation<13>;
+    case 14: return &PassIsolation<14>;
+    case 15: return &PassIsolation<15>;
+    case 2:  return &PassIsolation<2>;
+    case 21: return &PassIsolation<21>;
+    case 3:  return &PassIsolation<3>;
+    default: return &PassIsolation<-1>;
+  }
+}
+
+
+// Muon selection built once at startup: tight ID, trigger bit mask and isolation
+class MuonSelection {
+public:
+  ULong64_t trigMask;       // OR of the requested trigger bits
+  int isoCut;
+  float cutValue;
+  IsolationFunc isolation;
+
+  MuonSelection(const vector<int> &trigBits, int _isoCut, float _cutValue) {
+    trigMask = 0;
+    for (vector<int>::size_type idx=0; idx!=trigBits.size(); idx++) {
+      if (trigBits[idx]>=0 && trigBits[idx]<64) trigMask |= 1ULL<<trigBits[idx];     // others select nothing
+    }
+    isoCut = _isoCut;
+    cutValue = _cutValue;
+    isolation = GetIsolationFunc(isoCut);
+  }
+
+  // Muon and event both fired one of the requested triggers
+  inline bool PassTrigger(ULong64_t muTrig, ULong64_t HLTriggers) const {
+    return (muTrig & HLTriggers & trigMask) != 0;
+  }
+
+  inline bool Pass(const TreePFCandEventData &evt, int i_mu) const {
+    return (*evt.muIsTightMuon)[i_mu] && PassTrigger((*evt.muTrig)[i_mu], evt.HLTriggers) &&
+           isolation(evt, i_mu, cutValue);
+  }
+};
+
+
+// One selection variant of the multi-configuration mode, with its own output dataset
+class SelectionConfig {
+public:
+  vector<int> trigBits;
+  MuonSelection selection;
+  string name;
+  RooDataSet *dataset;
+  RowArena arena;
+  BinnedHists binned;
+  vector<RooDataSet*> splits;       // one dataset per category with -G split
+
+  SelectionConfig(int _isoCut, float _cutValue, const vector<int> &_trigBits) :
+    trigBits(_trigBits), selection(_trigBits, _isoCut, _cutValue), dataset(0) {
+    name = Form("dataset_iso%d_cut%g_trig", _isoCut, _cutValue);
+    for (vector<int>::size_type idx=0; idx!=trigBits.size(); idx++) {
+      name += Form(idx ? "_%d" : "%d", trigBits[idx]);
+    }
+  }
+};
+
+
+
 class TreeToDataset : public exception {
 public :
   //!pointer to the analyzed TTree or TChain
   TChain          *fChain;
 
-  // List of branches
-  TBranch        *b_runNb;   //!
-  TBranch        *b_eventNb;   //!
-  TBranch        *b_LS;   //!
-  TBranch        *b_CentBin;   //!
-  TBranch        *b_Npix;   //!
-  TBranch        *b_NpixelTracks;   //!
-  TBranch        *b_Ntracks;   //!
-  TBranch        *b_NtracksPtCut;   //!
-  TBranch        *b_NtracksEtaCut;   //!
-  TBranch        *b_NtracksEtaPtCut;   //!
-  TBranch        *b_SumET_HF;   //!
-  TBranch        *b_SumET_HFplus;   //!
-  TBranch        *b_SumET_HFminus;   //!
-  TBranch        *b_SumET_HFplusEta4;   //!
-  TBranch        *b_SumET_HFminusEta4;   //!
-  TBranch        *b_SumET_HFhit;   //!
-  TBranch        *b_SumET_HFhitPlus;   //!
-  TBranch        *b_SumET_HFhitMinus;   //!
-  TBranch        *b_SumET_ZDC;   //!
-  TBranch        *b_SumET_ZDCplus;   //!
-  TBranch        *b_SumET_ZDCminus;   //!
-  TBranch        *b_SumET_EEplus;   //!
-  TBranch        *b_SumET_EEminus;   //!
-  TBranch        *b_SumET_EE;   //!
-  TBranch        *b_SumET_EB;   //!
-  TBranch        *b_SumET_ET;   //!
-  TBranch        *b_nPV;   //!
-  TBranch        *b_RefVtx_x;   //!
-  TBranch        *b_RefVtx_y;   //!
-  TBranch        *b_RefVtx_z;   //!
-  TBranch        *b_RefVtx_xError;   //!
-  TBranch        *b_RefVtx_yError;   //!
-  TBranch        *b_RefVtx_zError;   //!
-  TBranch        *b_nPFpart;   //!
-  TBranch        *b_pfId;   //!
-  TBranch        *b_pfPt;   //!
-  TBranch        *b_pfEnergy;   //!
-  TBranch        *b_pfVsPt;   //!
-  TBranch        *b_pfVsPtInitial;   //!
-  TBranch        *b_pfArea;   //!
-  TBranch        *b_pfEta;   //!
-  TBranch        *b_pfPhi;   //!
-  TBranch        *b_pfCharge;   //!
-  TBranch        *b_pfTheta;   //!
-  TBranch        *b_pfEt;   //!
-  TBranch        *b_vn;   //!
-  TBranch        *b_vpsi;   //!
-  TBranch        *b_sumpt;   //!
-  TBranch        *b_pfMuonPx;   //!
-  TBranch        *b_pfMuonPy;   //!
-  TBranch        *b_pfMuonPz;   //!
-  TBranch        *b_pfTrackerMuon;   //!
-  TBranch        *b_pfTrackerMuonPt;   //!
-  TBranch        *b_pfTrackHits;   //!
-  TBranch        *b_pfDxy;   //!
-  TBranch        *b_pfDz;   //!
-  TBranch        *b_pfChi2;   //!
-  TBranch        *b_pfGlobalMuonPt;   //!
-  TBranch        *b_pfChargedPx;   //!
-  TBranch        *b_pfChargedPy;   //!
-  TBranch        *b_pfChargedPz;   //!
-  TBranch        *b_pfChargedTrackRefPt;   //!
-  TBranch        *b_nGENpart;   //!
-  TBranch        *b_genPDGId;   //!
-  TBranch        *b_genPt;   //!
-  TBranch        *b_genEta;   //!
-  TBranch        *b_genPhi;   //!
-  TBranch        *b_nTRACKpart;   //!
-  TBranch        *b_traQual;   //!
-  TBranch        *b_traCharge;   //!
-  TBranch        *b_traPt;   //!
-  TBranch        *b_traEta;   //!
-  TBranch        *b_traPhi;   //!
-  TBranch        *b_traAlgo;   //!
-  TBranch        *b_traHits;   //!
-  TBranch        *b_recoPFMET;   //!
-  TBranch        *b_recoPFMETPhi;   //!
-  TBranch        *b_recoPFMETsumEt;   //!
-  TBranch        *b_recoPFMETmEtSig;   //!
-  TBranch        *b_recoPFMETSig;   //!
-  TBranch        *b_nMUpart;   //!
-  TBranch        *b_muPx;   //!
-  TBranch        *b_muPy;   //!
-  TBranch        *b_muPz;   //!
-  TBranch        *b_muMt;   //!
-  TBranch        *b_muPt;   //!
-  TBranch        *b_muEta;   //!
-  TBranch        *b_muPhi;   //!
-  TBranch        *b_muCharge;   //!
-  TBranch        *b_muSelectionType;   //!
-  TBranch        *b_muTrackIso;   //!
-  TBranch        *b_muCaloIso;   //!
-  TBranch        *b_muEcalIso;   //!
-  TBranch        *b_muHcalIso;   //!
-  TBranch        *b_muSumChargedHadronPt;
-  TBranch        *b_muSumNeutralHadronEt;
-  TBranch        *b_muSumPhotonEt;
-  TBranch        *b_muSumPUPt;
-  TBranch        *b_muPFBasedDBetaIso;
-  TBranch        *b_muHighPurity;   //!
-  TBranch        *b_muIsTightMuon;   //!
-  TBranch        *b_muIsGoodMuon;   //!
-  TBranch        *b_muTrkMuArb;   //!
-  TBranch        *b_muTMOneStaTight;   //!
-  TBranch        *b_muNTrkHits;   //!
-  TBranch        *b_muNPixValHits;   //!
-  TBranch        *b_muNPixWMea;   //!
-  TBranch        *b_muNTrkWMea;   //!
-  TBranch        *b_muStationsMatched;   //!
-  TBranch        *b_muNMuValHits;   //!
-  TBranch        *b_muDxy;   //!
-  TBranch        *b_muDxyErr;   //!
-  TBranch        *b_muDz;   //!
-  TBranch        *b_muDzErr;   //!
-  TBranch        *b_muPtInner;   //!
-  TBranch        *b_muPtErrInner;   //!
-  TBranch        *b_muPtGlobal;   //!
-  TBranch        *b_muPtErrGlobal;   //!
-  TBranch        *b_muNormChi2Inner;   //!
-  TBranch        *b_muNormChi2Global;   //!
-  TBranch        *b_muIso03_sumPt;
-  TBranch        *b_muIso04_sumPt;
-  TBranch        *b_muIso05_sumPt;
-  TBranch        *b_muIso03_emEt;
-  TBranch        *b_muIso04_emEt;
-  TBranch        *b_muIso05_emEt;
-  TBranch        *b_muIso03_hadEt;
-  TBranch        *b_muIso04_hadEt;
-  TBranch        *b_muIso05_hadEt;
-  TBranch        *b_muIso03_nTracks;
-  TBranch        *b_muIso04_nTracks;
-  TBranch        *b_muIso05_nTracks;
-  TBranch        *b_muNotPFMuon;
-  TBranch        *b_muTrig;   //!
-  TBranch        *b_HLTriggers;   //!
-  TBranch        *b_trigPrescale;   //!
+  // List of branches, one per entry of PFTREE_BRANCHES
+#define PFTREE_SCALAR_HANDLE(type, name) TBranch *b_##name;
+#define PFTREE_HANDLE(type, name, extra) TBranch *b_##name;
+  PFTREE_BRANCHES(PFTREE_SCALAR_HANDLE, PFTREE_HANDLE, PFTREE_HANDLE)
+#undef PFTREE_SCALAR_HANDLE
+#undef PFTREE_HANDLE
 
   vector<string> filename;  // input file names
+  string treeName;          // tree read from the input files
+  string cacheDir;          // directory of muon-level skim caches, empty to disable
+  string indexFile;         // entries of already validated input files, empty to disable
+  vector<Long64_t> fileEntries;     // entries of each input file, known after CheckInputs()
 
   bool doMC;
   int trigIdx;
+  vector<int> trigBits;     // muon and event must have fired one of these triggers
+  ULong64_t trigMask;
   int isoCut;
   float cutValue;
+  bool activeOnly;          // read only the branches needed by the selection
+  set<string> activeBranches;
+  bool allIsolation;        // also read the inputs of every isolation type stored in the tree
+  map<string, TBranch**> branchHandles;
+  string schemaError;       // branches needed by the selection that are missing or of another type
+  vector<string> absentBranches;    // other branches of the schema not in the tree, left unbound
+  bool stagedRead;          // read trigger/ID branches first, the rest only for candidate events
+  vector<TBranch**> stageBranches;
+  Long64_t nStageTrigger, nStageMuon, nStageFull;
+  int nThreads;             // number of worker threads in Loop()
+  Long64_t firstEntry;      // first entry of the chain to process
+  Long64_t nEvents;         // entries to process from firstEntry, -1 for all
+  int shard, nShards;       // process only part shard of nShards of that range
+  Long64_t loopFirst, loopLast;     // entries processed by the last Loop()
+  int workerId;             // -1 for the main instance
+  bool bufferRows;          // keep accepted candidates in the arena until the caller moves them
+  RowArena arena;           // accepted candidates (TMass, MET, Pt, Eta[, GenPt, GenDR, GenMother][, PairMass, ZFlag][, Category]) not yet in the dataset
+  vector<Float_t> rowBuffer;        // one row of the arena columns
+  RowArena batchRows;       // rows of the candidates waiting in the isolation batch
+  int colTMass, colMET, colEta, colGenMother, colCharge;    // columns of a row, -1 when absent
+  GenMatcher genMatch;      // reco-gen muon matching with doMC
+  PFConeIso pfIso;          // cone sums from the PF candidates for isoCut 6X and 7X
+  DimuonPairs zPairs;       // opposite-charge pairs for the Z veto/flag
+  BinnedHists binned;       // TMass/MET histograms per eta bin and charge
+  CategoryScheme categories;        // charge/eta/centrality category of each row
+  IsoScan isoScan;          // relIso of every tree isolation type for the threshold scan
+  DatasetStream stream;     // datasets stored in a tree of the open output file
+  vector<SelectionConfig> configs;  // selections filled in one pass, each into its own dataset
+  int batchSize;            // candidates per batched isolation evaluation, 0 to disable
+  Long64_t cacheSize;       // TTreeCache size in bytes, -1 for the ROOT default, 0 to disable
+  int cacheLearn;           // entries for the cache to learn the branches, 0 to register the branches in use
+  bool prefetch;            // asynchronous read-ahead and unzipping of the next baskets
+  Long64_t treeFirst, treeLast;     // entries of the chain in the file being read
+  IsoBatch batch;
+  LoopStats stats;          // cut flow and stage timing of this instance (workers summed in)
+  bool perfStats;           // attach TTreePerfStats to fChain in single-threaded loops
+  TTreePerfStats *perf;
   
   TreePFCandEventData pfEvt_;
   
@@ -361,25 +267,106 @@ public :
   RooRealVar *MET;
   RooRealVar *Pt;
   RooRealVar *Eta;
+  RooRealVar *GenPt;
+  RooRealVar *GenDR;
+  RooRealVar *GenMother;
+  RooRealVar *PairMass;
+  RooRealVar *ZFlag;
+  RooCategory *Category;
   
   RooDataSet *dataset;
+  vector<RooDataSet*> splitDatasets;        // one dataset per category with -G split
 
   TreeToDataset(vector<string> _filelist, bool _doMC, int _trigIdx, int _isoCut, float _cutValue);
   virtual ~TreeToDataset();
   virtual string   OpenInputs();
+  string CheckInputs();
+  virtual void     OpenChain();
+  string SkimKey();
+  string OpenSkimCache();
+  string WriteSkimCache(const string &cacheFile, const string &key);
+  void CopyOptions(const TreeToDataset &other);
+  void SetColumns();
+  Long64_t AlignToCluster(Long64_t entry);
+  void EntryRange(Long64_t &first, Long64_t &last);
   virtual void     SetBranches();
+  virtual void     SetActiveBranches();
+  static void AddSelectionBranches(set<string> &branches);
+  static void AddIsolationBranches(int _isoCut, set<string> &branches);
+  static void AddTreeIsolationBranches(set<string> &branches);
+  static map<string, string> InputBranches();
+  void AddSelection(int _isoCut, float _cutValue, const vector<int> &bits);
+  template <typename T> void BindBranch(const char *name, T *address, TBranch **branch, const string &type, const set<string> &needed);
+  virtual void     SetStageBranches();
+  bool ReadStaged(Long64_t entry);
+  bool ReadEntry(Long64_t entry);
+  void SetCache();
+  void CollectCacheStats();
   virtual void     MakeRooDataset();
+  bool WriteFlat(RooDataSet *data, const string &path);
   virtual int      Loop();
+  int LoopRange(Long64_t first, Long64_t last);
+  int LoopRangeMulti(Long64_t first, Long64_t last);
+  void MoveArenas();
+  int LoopParallel(Long64_t first, Long64_t last);
+  int LoadColumns(MuonColumns &columns);
   bool CheckIsolation(int i_mu);
+  void SetTriggers(const vector<int> &bits);
+  template <int ISO> int LoopRangeT(Long64_t first, Long64_t last);
+  template <typename MuonFunc, typename EventFunc> int ForEachCandidate(Long64_t first, Long64_t last, MuonFunc onMuon, EventFunc onEvent);
+  void MakeRow(int i_mu, Float_t *row);
+  void FillCandidate(const Float_t *row);
+  void CountGenMatch(const Float_t *row);
+  void IndexGen();
+  void PushBatch(int i_mu);
+  void FlushBatch();
 };
 
 
 TreeToDataset::TreeToDataset(vector<string> _filelist, bool _doMC, int _trigIdx=5, int _isoCut=13, float _cutValue=0.1)
 {
   doMC = _doMC;
-  trigIdx = _trigIdx;
+  SetTriggers(vector<int>(1, _trigIdx));
   isoCut = _isoCut;
   cutValue = _cutValue;
+  treeName = "pfcandAnalyzer/pfTree";
+  fChain = 0;
+  TMass = 0;
+  MET = 0;
+  Pt = 0;
+  Eta = 0;
+  GenPt = 0;
+  GenDR = 0;
+  GenMother = 0;
+  PairMass = 0;
+  ZFlag = 0;
+  Category = 0;
+  dataset = 0;
+  activeOnly = false;
+  allIsolation = false;
+  stagedRead = false;
+  nStageTrigger = 0;
+  nStageMuon = 0;
+  nStageFull = 0;
+  nThreads = 1;
+  firstEntry = 0;
+  nEvents = -1;
+  shard = 0;
+  nShards = 1;
+  loopFirst = 0;
+  loopLast = 0;
+  workerId = -1;
+  bufferRows = false;
+  SetColumns();
+  pfIso.AddCone(isoCut);
+  batchSize = 0;
+  perfStats = false;
+  perf = 0;
+  cacheSize = -1;
+  cacheLearn = 0;
+  prefetch = false;
+  treeFirst = 0;
+  treeLast = 0;
 
   // Copy filenames from a list
   for (vector<string>::size_type idx=0; idx!=_filelist.size(); idx++) {
@@ -389,23 +376,343 @@ TreeToDataset::TreeToDataset(vector<string> _filelist, bool _doMC, int _trigIdx=
 
 string TreeToDataset::OpenInputs() {
   // Check if input files are valid
+  string out = CheckInputs();
+  if (out!="") return out;
+
+  // Read from the muon-level skim instead of the full tree
+  if (cacheDir!="") {
+    out = OpenSkimCache();
+    if (out!="") return out;
+  }
+
+  OpenChain();
+  if (schemaError!="") return "Input tree does not match the branch schema:" + schemaError;
+
+  return "";
+}
+
+
+string TreeToDataset::CheckInputs() {
+  // Files listed in the index with the same size and modification time are not opened again
+  Manifest index;
+  if (indexFile!="" && !gSystem->AccessPathName(indexFile.c_str())) {
+    TFile *file = TFile::Open(indexFile.c_str());
+    if (file && !file->IsZombie()) index.Read(file);
+    delete file;
+  }
+
+  // Entries already set by the caller are from files checked before
+  if (fileEntries.size()!=filename.size()) fileEntries.assign(filename.size(), -1);
+  vector<InputStatus> todo;
+  vector<ManifestEntry> stamps(filename.size());
+  for (vector<string>::size_type idx=0; idx!=filename.size(); idx++) {
+    if (fileEntries[idx]>=0) continue;
+    int prev = index.Find(filename[idx]);
+    if (prev>=0 && Manifest::Stat(filename[idx], stamps[idx]) &&
+        stamps[idx].size==index.files[prev].size && stamps[idx].mtime==index.files[prev].mtime) {
+      fileEntries[idx] = index.files[prev].entries;
+    } else todo.push_back(InputStatus(filename[idx]));
+  }
+
+  // I/O bound: use more threads than the event loop does
+  if (!todo.empty()) {
+    if (workerId<0) cout << "Checking " << todo.size() << " of " << filename.size() << " input files" << endl;
+    CheckInputFiles(todo, treeName, InputBranches(), max(nThreads, 8));
+  }
+
+  // Report every unusable file at once
+  string errors;
+  int nbad = 0;
+  bool updated = false;
+  for (vector<InputStatus>::size_type idx=0, jdx=0; idx!=todo.size(); idx++) {
+    while (filename[jdx]!=todo[idx].path) jdx++;
+    if (todo[idx].error!="") {
+      errors += "\n  " + todo[idx].path + ": " + todo[idx].error;
+      nbad++;
+      continue;
+    }
+    fileEntries[jdx] = todo[idx].entries;
+    if (indexFile=="" || !Manifest::Stat(filename[jdx], stamps[jdx])) continue;
+    stamps[jdx].entries = todo[idx].entries;
+    int prev = index.Find(filename[jdx]);
+    if (prev>=0) index.files[prev] = stamps[jdx];
+    else index.Add(stamps[jdx]);
+    updated = true;
+  }
+  if (nbad) return Form("%d of %d input files cannot be used:", nbad, (int)filename.size()) + errors;
+
+  // Only the main instance writes the index
+  if (updated && workerId<0) {
+    TFile *file = TFile::Open(indexFile.c_str(), "RECREATE");
+    if (file && !file->IsZombie()) index.Write(file);
+    else cout << "Cannot write input index: " << indexFile << endl;
+    delete file;
+  }
+  return "";
+}
+
+
+string TreeToDataset::SkimKey() {
+  // Input files with their sizes and modification times; any change gives a new cache
+  string key = doMC ? "mc\n" : "data\n";
   for (vector<string>::size_type idx=0; idx!=filename.size(); idx++) {
-    if (!TFile::Open(filename[idx].c_str()))
-      return string("Cannot open input file: ")+ filename[idx];
+    FileStat_t stat;
+    if (gSystem->GetPathInfo(filename[idx].c_str(), stat)) {
+      stat.fSize = -1;
+      stat.fMtime = -1;
+    }
+    key += Form("%s %lld %ld\n", filename[idx].c_str(), stat.fSize, stat.fMtime);
   }
+  return key;
+}
+
 
-  fChain = new TChain("pfcandAnalyzer/pfTree");
+string TreeToDataset::OpenSkimCache() {
+  string key = SkimKey();
+  TMD5 md5;
+  md5.Update((const UChar_t*)key.c_str(), key.size());
+  md5.Final();
+  string cacheFile = cacheDir + "/skim_" + md5.AsString() + ".root";
+
+  // Reuse the cache only if it was made from exactly these inputs
+  bool valid = false;
+  if (!gSystem->AccessPathName(cacheFile.c_str())) {
+    TFile *cache = TFile::Open(cacheFile.c_str());
+    if (cache && !cache->IsZombie()) {
+      TNamed *stored = dynamic_cast<TNamed*>(cache->Get("skimKey"));
+      valid = stored && key==stored->GetTitle() && cache->Get("muonSkim");
+    }
+    delete cache;
+  }
+
+  if (valid) cout << "Reading skim cache : " << cacheFile << endl;
+  else {
+    gSystem->mkdir(cacheDir.c_str(), kTRUE);
+    string out = WriteSkimCache(cacheFile, key);
+    if (out!="") return out;
+  }
+
+  filename.assign(1, cacheFile);
+  fileEntries.clear();
+  treeName = "muonSkim";
+  activeOnly = true;        // the cache only has the muon-level branches
+  return "";
+}
+
+
+string TreeToDataset::WriteSkimCache(const string &cacheFile, const string &key) {
+  cout << "Writing skim cache : " << cacheFile << endl;
+
+  TChain *chain = new TChain(treeName.c_str());
+  for (vector<string>::size_type idx=0; idx!=filename.size(); idx++) {
+    chain->AddFile(filename[idx].c_str());
+  }
+
+  // Muon vectors, trigger bits, MET and event identifiers
+  chain->SetBranchStatus("*",0);
+  const char *skimBranches[] = {"runNb", "eventNb", "LS", "CentBin", "nMUpart", "mu*",
+                                "HLTriggers", "recoPFMET*"};
+  for (unsigned int idx=0; idx<sizeof(skimBranches)/sizeof(skimBranches[0]); idx++) {
+    chain->SetBranchStatus(skimBranches[idx],1);
+  }
+  if (doMC) {
+    chain->SetBranchStatus("nGENpart",1);
+    chain->SetBranchStatus("gen*",1);
+  }
+  Int_t nMUpart = 0;
+  chain->SetBranchAddress("nMUpart", &nMUpart);
+
+  // Write to a temporary file so that an interrupted job leaves no cache behind
+  string tmpFile = cacheFile + Form(".%d.tmp", gSystem->GetPid());
+  TFile *out = new TFile(tmpFile.c_str(),"RECREATE");
+  if (out->IsZombie()) {
+    delete out;
+    delete chain;
+    return string("Cannot write skim cache: ") + tmpFile;
+  }
+  TTree *skim = chain->CloneTree(0);
+  skim->SetName("muonSkim");
+
+  Long64_t nentries = chain->GetEntries();
+  for (Long64_t evt=0; evt<nentries; evt++) {
+    if ( evt%100000 == 0 ) cout << "Skim: " << evt  << " / " << nentries << endl;
+    chain->GetEntry(evt);
+    if (nMUpart>0) skim->Fill();
+  }
+
+  out->cd();
+  skim->Write();
+  TNamed("skimKey", key.c_str()).Write();
+  out->Close();
+  delete out;
+  delete chain;
+
+  if (gSystem->Rename(tmpFile.c_str(), cacheFile.c_str())) {
+    return string("Cannot move skim cache to ") + cacheFile;
+  }
+  return "";
+}
+
+
+void TreeToDataset::OpenChain() {
+  // Must be set before the files are opened and their caches created
+  if (prefetch) {
+    gEnv->SetValue("TFile.AsyncPrefetching", 1);
+    TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+  }
+
+  fChain = new TChain(treeName.c_str());
   // Load files
   for (vector<string>::size_type idx=0; idx!=filename.size(); idx++) {
-    fChain->AddFile(filename[idx].c_str());
-    cout << "Loading : " << filename[idx] << endl;
+    // With the entries known the chain does not open the file here
+    Long64_t entries = (idx<fileEntries.size() && fileEntries[idx]>0) ? fileEntries[idx] : TTree::kMaxEntries;
+    fChain->AddFile(filename[idx].c_str(), entries);
+    if (workerId<0) cout << "Loading : " << filename[idx] << endl;
   }
 
   // Initalize tree/chain
   pfEvt_.Init();
   SetBranches();
+  SetCache();
+}
 
-  return "";
+
+void TreeToDataset::SetCache() {
+  if (cacheSize==0) {
+    fChain->SetCacheSize(0);
+    return;
+  }
+  if (cacheSize>0) fChain->SetCacheSize(cacheSize);
+  if (cacheLearn>0) {
+    fChain->SetCacheLearnEntries(cacheLearn);
+    return;
+  }
+
+  // Known branch set: fill the cache with exactly these branches from the first entry on
+  if (activeBranches.empty() || fChain->LoadTree(0)<0) return;
+  for (set<string>::iterator it=activeBranches.begin(); it!=activeBranches.end(); ++it) {
+    fChain->AddBranchToCache(it->c_str(), kTRUE);
+  }
+  fChain->StopCacheLearningPhase();
+}
+
+
+void TreeToDataset::CollectCacheStats() {
+  // Hit efficiency of the cache of the file being left
+  if (treeLast<=treeFirst || !fChain->GetCurrentFile()) return;
+  TTreeCache *cache = dynamic_cast<TTreeCache*>(fChain->GetCurrentFile()->GetCacheRead(fChain->GetTree()));
+  if (!cache) return;
+  stats.cacheEfficiency += cache->GetEfficiency();
+  stats.cacheEfficiencyRel += cache->GetEfficiencyRel();
+  stats.cacheFiles++;
+}
+
+
+void TreeToDataset::SetColumns() {
+  // Dataset columns: the W candidate, then the optional gen match and dimuon pair columns
+  vector<string> names;
+  const char *columns[] = {"TMass", "MET", "Pt", "Eta"};
+  names.assign(columns, columns+4);
+  if (doMC) {
+    const char *genColumns[] = {"GenPt", "GenDR", "GenMother"};
+    names.insert(names.end(), genColumns, genColumns+3);
+  }
+  if (zPairs.mode==DimuonPairs::kFlag) {
+    names.push_back("PairMass");
+    names.push_back("ZFlag");
+  }
+  if (categories.Active()) names.push_back("Category");
+  arena.SetColumns(names);
+  arena.splitColumn = categories.mode==CategoryScheme::kSplit ? names.size()-1 : -1;
+  rowBuffer.resize(names.size()+1);         // muon charge after the columns, for the histograms
+  names.push_back("Charge");
+  batchRows.SetColumns(names);
+  colTMass = batchRows.Column("TMass");
+  colMET = batchRows.Column("MET");
+  colEta = batchRows.Column("Eta");
+  colGenMother = batchRows.Column("GenMother");
+  colCharge = batchRows.Column("Charge");
+  for (vector<SelectionConfig>::size_type idx=0; idx!=configs.size(); idx++) {
+    configs[idx].arena.SetColumns(arena.names);
+    configs[idx].arena.splitColumn = arena.splitColumn;
+  }
+}
+
+
+void TreeToDataset::CopyOptions(const TreeToDataset &other) {
+  // Read settings shared by the main instance and its workers
+  SetTriggers(other.trigBits);
+  treeName = other.treeName;
+  activeOnly = other.activeOnly;
+  allIsolation = other.allIsolation;
+  stagedRead = other.stagedRead;
+  batchSize = other.batchSize;
+  cacheSize = other.cacheSize;
+  cacheLearn = other.cacheLearn;
+  prefetch = other.prefetch;
+  fileEntries = other.fileEntries;
+  genMatch.maxDR = other.genMatch.maxDR;
+  pfIso.SetVetoes(other.pfIso.Vetoes());
+  zPairs.mode = other.zPairs.mode;
+  zPairs.massMin = other.zPairs.massMin;
+  zPairs.massMax = other.zPairs.massMax;
+  categories = other.categories;
+  SetColumns();
+  binned.BookAs(other.binned);
+  isoScan.BookAs(other.isoScan);
+  arena.chunkRows = other.arena.chunkRows;
+  configs.clear();
+  for (vector<SelectionConfig>::size_type idx=0; idx!=other.configs.size(); idx++) {
+    const SelectionConfig &config = other.configs[idx];
+    AddSelection(config.selection.isoCut, config.selection.cutValue, config.trigBits);
+  }
+}
+
+
+void TreeToDataset::SetTriggers(const vector<int> &bits) {
+  trigBits = bits;
+  trigIdx = bits.empty() ? -1 : bits[0];
+  trigMask = MuonSelection(bits, isoCut, cutValue).trigMask;
+}
+
+
+void TreeToDataset::AddSelection(int _isoCut, float _cutValue, const vector<int> &bits) {
+  configs.push_back(SelectionConfig(_isoCut, _cutValue, bits));
+  pfIso.AddCone(_isoCut);
+  configs.back().arena.chunkRows = arena.chunkRows;
+  configs.back().arena.SetColumns(arena.names);
+  configs.back().arena.splitColumn = arena.splitColumn;
+  configs.back().binned.BookAs(binned);
+
+  // Events are read if any of the selections can use them
+  if (configs.size()==1) trigMask = 0;
+  trigMask |= configs.back().selection.trigMask;
+}
+
+
+Long64_t TreeToDataset::AlignToCluster(Long64_t entry) {
+  // Move an entry back to the first entry of its cluster of baskets
+  if (entry<=0) return 0;
+  if (entry>=fChain->GetEntries()) return fChain->GetEntries();
+  Long64_t local = fChain->LoadTree(entry);
+  if (local<0) return entry;
+  TTree::TClusterIterator clusters = fChain->GetTree()->GetClusterIterator(local);
+  return entry - local + clusters.Next();
+}
+
+
+void TreeToDataset::EntryRange(Long64_t &first, Long64_t &last) {
+  // Entries selected with firstEntry/nEvents, then the part of this shard.
+  // Shard boundaries are on clusters and depend only on the chain, so the shards
+  // of a job cover the range exactly once and in order.
+  Long64_t nentries = fChain->GetEntries();
+  Long64_t begin = min(max(firstEntry, 0LL), nentries);
+  Long64_t end = (nEvents<0) ? nentries : min(begin+nEvents, nentries);
+  first = begin;
+  last = end;
+  if (nShards<=1) return;
+  if (shard>0) first = min(max(begin, AlignToCluster(begin + (end-begin)*shard/nShards)), end);
+  if (shard<nShards-1) last = min(max(begin, AlignToCluster(begin + (end-begin)*(shard+1)/nShards)), end);
 }
 
 
@@ -415,157 +722,190 @@ TreeToDataset::~TreeToDataset()
   delete MET;
   delete Pt;
   delete Eta;
+  delete GenPt;
+  delete GenDR;
+  delete GenMother;
+  delete PairMass;
+  delete ZFlag;
+  delete Category;
+  for (vector<RooDataSet*>::size_type idx=0; idx!=splitDatasets.size(); idx++) delete splitDatasets[idx];
   delete dataset;
+  for (vector<SelectionConfig>::size_type idx=0; idx!=configs.size(); idx++) {
+    delete configs[idx].dataset;
+    for (vector<RooDataSet*>::size_type cat=0; cat!=configs[idx].splits.size(); cat++) delete configs[idx].splits[cat];
+  }
+  if (perf && fChain) fChain->SetPerfStats(0);
+  delete perf;
 
   if (!fChain) return;
   delete fChain;
 }
 
 
+template <typename T>
+void TreeToDataset::BindBranch(const char *name, T *address, TBranch **branch, const string &type, const set<string> &needed) {
+  *branch = 0;
+  branchHandles[name] = branch;
+  if (activeOnly && activeBranches.find(name)==activeBranches.end()) return;
+
+  // Branches missing in older ntuples are left unbound; an error only if the selection uses them
+  TBranch *found = fChain->GetBranch(name);
+  string foundType = found ? BranchType(found) : "";
+  if (foundType!=type) {
+    string problem = found ? Form("%s is %s, expected %s", name, foundType.c_str(), type.c_str()) : name;
+    if (needed.count(name)) schemaError += "\n  " + (found ? problem : "missing " + problem);
+    else absentBranches.push_back(problem);
+    return;
+  }
+  fChain->SetBranchAddress(name, address, branch);
+}
+
+
 void TreeToDataset::SetBranches() {
   // Set branch addresses and branch pointers
   if (!fChain) return;
   fChain->SetMakeClass(1);
 
-  fChain->SetBranchAddress("runNb", &pfEvt_.runNb, &b_runNb);
-  fChain->SetBranchAddress("eventNb", &pfEvt_.eventNb, &b_eventNb);
-  fChain->SetBranchAddress("LS", &pfEvt_.LS, &b_LS);
-  fChain->SetBranchAddress("CentBin", &pfEvt_.CentBin, &b_CentBin);
-  fChain->SetBranchAddress("Npix", &pfEvt_.Npix, &b_Npix);
-  fChain->SetBranchAddress("NpixelTracks", &pfEvt_.NpixelTracks, &b_NpixelTracks);
-  fChain->SetBranchAddress("Ntracks", &pfEvt_.Ntracks, &b_Ntracks);
-  fChain->SetBranchAddress("NtracksPtCut", &pfEvt_.NtracksPtCut, &b_NtracksPtCut);
-  fChain->SetBranchAddress("NtracksEtaCut", &pfEvt_.NtracksEtaCut, &b_NtracksEtaCut);
-  fChain->SetBranchAddress("NtracksEtaPtCut", &pfEvt_.NtracksEtaPtCut, &b_NtracksEtaPtCut);
-  fChain->SetBranchAddress("SumET_HF", &pfEvt_.SumET_HF, &b_SumET_HF);
-  fChain->SetBranchAddress("SumET_HFplus", &pfEvt_.SumET_HFplus, &b_SumET_HFplus);
-  fChain->SetBranchAddress("SumET_HFminus", &pfEvt_.SumET_HFminus, &b_SumET_HFminus);
-  fChain->SetBranchAddress("SumET_HFplusEta4", &pfEvt_.SumET_HFplusEta4, &b_SumET_HFplusEta4);
-  fChain->SetBranchAddress("SumET_HFminusEta4", &pfEvt_.SumET_HFminusEta4, &b_SumET_HFminusEta4);
-  fChain->SetBranchAddress("SumET_HFhit", &pfEvt_.SumET_HFhit, &b_SumET_HFhit);
-  fChain->SetBranchAddress("SumET_HFhitPlus", &pfEvt_.SumET_HFhitPlus, &b_SumET_HFhitPlus);
-  fChain->SetBranchAddress("SumET_HFhitMinus", &pfEvt_.SumET_HFhitMinus, &b_SumET_HFhitMinus);
-  fChain->SetBranchAddress("SumET_ZDC", &pfEvt_.SumET_ZDC, &b_SumET_ZDC);
-  fChain->SetBranchAddress("SumET_ZDCplus", &pfEvt_.SumET_ZDCplus, &b_SumET_ZDCplus);
-  fChain->SetBranchAddress("SumET_ZDCminus", &pfEvt_.SumET_ZDCminus, &b_SumET_ZDCminus);
-  fChain->SetBranchAddress("SumET_EEplus", &pfEvt_.SumET_EEplus, &b_SumET_EEplus);
-  fChain->SetBranchAddress("SumET_EEminus", &pfEvt_.SumET_EEminus, &b_SumET_EEminus);
-  fChain->SetBranchAddress("SumET_EE", &pfEvt_.SumET_EE, &b_SumET_EE);
-  fChain->SetBranchAddress("SumET_EB", &pfEvt_.SumET_EB, &b_SumET_EB);
-  fChain->SetBranchAddress("SumET_ET", &pfEvt_.SumET_ET, &b_SumET_ET);
-  fChain->SetBranchAddress("nPV", &pfEvt_.nPV, &b_nPV);
-  fChain->SetBranchAddress("RefVtx_x", &pfEvt_.RefVtx_x, &b_RefVtx_x);
-  fChain->SetBranchAddress("RefVtx_y", &pfEvt_.RefVtx_y, &b_RefVtx_y);
-  fChain->SetBranchAddress("RefVtx_z", &pfEvt_.RefVtx_z, &b_RefVtx_z);
-  fChain->SetBranchAddress("RefVtx_xError", &pfEvt_.RefVtx_xError, &b_RefVtx_xError);
-  fChain->SetBranchAddress("RefVtx_yError", &pfEvt_.RefVtx_yError, &b_RefVtx_yError);
-  fChain->SetBranchAddress("RefVtx_zError", &pfEvt_.RefVtx_zError, &b_RefVtx_zError);
-  fChain->SetBranchAddress("nPFpart", &pfEvt_.nPFpart, &b_nPFpart);
-  fChain->SetBranchAddress("pfId", &pfEvt_.pfId, &b_pfId);
-  fChain->SetBranchAddress("pfPt", &pfEvt_.pfPt, &b_pfPt);
-  fChain->SetBranchAddress("pfEnergy", &pfEvt_.pfEnergy, &b_pfEnergy);
-  fChain->SetBranchAddress("pfVsPt", &pfEvt_.pfVsPt, &b_pfVsPt);
-  fChain->SetBranchAddress("pfVsPtInitial", &pfEvt_.pfVsPtInitial, &b_pfVsPtInitial);
-  fChain->SetBranchAddress("pfArea", &pfEvt_.pfArea, &b_pfArea);
-  fChain->SetBranchAddress("pfEta", &pfEvt_.pfEta, &b_pfEta);
-  fChain->SetBranchAddress("pfPhi", &pfEvt_.pfPhi, &b_pfPhi);
-  fChain->SetBranchAddress("pfCharge", &pfEvt_.pfCharge, &b_pfCharge);
-  fChain->SetBranchAddress("pfTheta", &pfEvt_.pfTheta, &b_pfTheta);
-  fChain->SetBranchAddress("pfEt", &pfEvt_.pfEt, &b_pfEt);
-  fChain->SetBranchAddress("vn", &pfEvt_.vn, &b_vn);
-  fChain->SetBranchAddress("psin", &pfEvt_.psin, &b_vpsi);
-  fChain->SetBranchAddress("sumpt", &pfEvt_.sumpt, &b_sumpt);
-  fChain->SetBranchAddress("pfMuonPx", &pfEvt_.pfMuonPx, &b_pfMuonPx);
-  fChain->SetBranchAddress("pfMuonPy", &pfEvt_.pfMuonPy, &b_pfMuonPy);
-  fChain->SetBranchAddress("pfMuonPz", &pfEvt_.pfMuonPz, &b_pfMuonPz);
-  fChain->SetBranchAddress("pfTrackerMuon", &pfEvt_.pfTrackerMuon, &b_pfTrackerMuon);
-  fChain->SetBranchAddress("pfTrackerMuonPt", &pfEvt_.pfTrackerMuonPt, &b_pfTrackerMuonPt);
-  fChain->SetBranchAddress("pfTrackHits", &pfEvt_.pfTrackHits, &b_pfTrackHits);
-  fChain->SetBranchAddress("pfDxy", &pfEvt_.pfDxy, &b_pfDxy);
-  fChain->SetBranchAddress("pfDz", &pfEvt_.pfDz, &b_pfDz);
-  fChain->SetBranchAddress("pfChi2", &pfEvt_.pfChi2, &b_pfChi2);
-  fChain->SetBranchAddress("pfGlobalMuonPt", &pfEvt_.pfGlobalMuonPt, &b_pfGlobalMuonPt);
-  fChain->SetBranchAddress("pfChargedPx", &pfEvt_.pfChargedPx, &b_pfChargedPx);
-  fChain->SetBranchAddress("pfChargedPy", &pfEvt_.pfChargedPy, &b_pfChargedPy);
-  fChain->SetBranchAddress("pfChargedPz", &pfEvt_.pfChargedPz, &b_pfChargedPz);
-  fChain->SetBranchAddress("pfChargedTrackRefPt", &pfEvt_.pfChargedTrackRefPt, &b_pfChargedTrackRefPt);
-  fChain->SetBranchAddress("nGENpart", &pfEvt_.nGENpart, &b_nGENpart);
-  fChain->SetBranchAddress("genPDGId", &pfEvt_.genPDGId, &b_genPDGId);
-  fChain->SetBranchAddress("genPt", &pfEvt_.genPt, &b_genPt);
-  fChain->SetBranchAddress("genEta", &pfEvt_.genEta, &b_genEta);
-  fChain->SetBranchAddress("genPhi", &pfEvt_.genPhi, &b_genPhi);
-  fChain->SetBranchAddress("nTRACKpart", &pfEvt_.nTRACKpart, &b_nTRACKpart);
-  fChain->SetBranchAddress("traQual", &pfEvt_.traQual, &b_traQual);
-  fChain->SetBranchAddress("traCharge", &pfEvt_.traCharge, &b_traCharge);
-  fChain->SetBranchAddress("traPt", &pfEvt_.traPt, &b_traPt);
-  fChain->SetBranchAddress("traEta", &pfEvt_.traEta, &b_traEta);
-  fChain->SetBranchAddress("traPhi", &pfEvt_.traPhi, &b_traPhi);
-  fChain->SetBranchAddress("traAlgo", &pfEvt_.traAlgo, &b_traAlgo);
-  fChain->SetBranchAddress("traHits", &pfEvt_.traHits, &b_traHits);
-  fChain->SetBranchAddress("recoPFMET", &pfEvt_.recoPFMET, &b_recoPFMET);
-  fChain->SetBranchAddress("recoPFMETPhi", &pfEvt_.recoPFMETPhi, &b_recoPFMETPhi);
-  fChain->SetBranchAddress("recoPFMETsumEt", &pfEvt_.recoPFMETsumEt, &b_recoPFMETsumEt);
-  fChain->SetBranchAddress("recoPFMETmEtSig", &pfEvt_.recoPFMETmEtSig, &b_recoPFMETmEtSig);
-  fChain->SetBranchAddress("recoPFMETSig", &pfEvt_.recoPFMETSig, &b_recoPFMETSig);
-  fChain->SetBranchAddress("nMUpart", &pfEvt_.nMUpart, &b_nMUpart);
-  fChain->SetBranchAddress("muPx", &pfEvt_.muPx, &b_muPx);
-  fChain->SetBranchAddress("muPy", &pfEvt_.muPy, &b_muPy);
-  fChain->SetBranchAddress("muPz", &pfEvt_.muPz, &b_muPz);
-  fChain->SetBranchAddress("muMt", &pfEvt_.muMt, &b_muMt);
-  fChain->SetBranchAddress("muPt", &pfEvt_.muPt, &b_muPt);
-  fChain->SetBranchAddress("muEta", &pfEvt_.muEta, &b_muEta);
-  fChain->SetBranchAddress("muPhi", &pfEvt_.muPhi, &b_muPhi);
-  fChain->SetBranchAddress("muCharge", &pfEvt_.muCharge, &b_muCharge);
-  fChain->SetBranchAddress("muSelectionType", &pfEvt_.muSelectionType, &b_muSelectionType);
-  fChain->SetBranchAddress("muTrackIso", &pfEvt_.muTrackIso, &b_muTrackIso);
-  fChain->SetBranchAddress("muCaloIso", &pfEvt_.muCaloIso, &b_muCaloIso);
-  fChain->SetBranchAddress("muEcalIso", &pfEvt_.muEcalIso, &b_muEcalIso);
-  fChain->SetBranchAddress("muHcalIso", &pfEvt_.muHcalIso, &b_muHcalIso);
-  fChain->SetBranchAddress("muSumChargedHadronPt",&pfEvt_.muSumChargedHadronPt, &b_muSumChargedHadronPt);
-  fChain->SetBranchAddress("muSumNeutralHadronEt",&pfEvt_.muSumNeutralHadronEt, &b_muSumNeutralHadronEt);
-  fChain->SetBranchAddress("muSumPhotonEt",&pfEvt_.muSumPhotonEt, &b_muSumPhotonEt);
-  fChain->SetBranchAddress("muSumPUPt",&pfEvt_.muSumPUPt, &b_muSumPUPt);
-  fChain->SetBranchAddress("muPFBasedDBetaIso",&pfEvt_.muPFBasedDBetaIso, &b_muPFBasedDBetaIso);
-  fChain->SetBranchAddress("muHighPurity", &pfEvt_.muHighPurity, &b_muHighPurity);
-  fChain->SetBranchAddress("muIsTightMuon", &pfEvt_.muIsTightMuon, &b_muIsTightMuon);
-  fChain->SetBranchAddress("muIsGoodMuon", &pfEvt_.muIsGoodMuon, &b_muIsGoodMuon);
-  fChain->SetBranchAddress("muTrkMuArb", &pfEvt_.muTrkMuArb, &b_muTrkMuArb);
-  fChain->SetBranchAddress("muTMOneStaTight", &pfEvt_.muTMOneStaTight, &b_muTMOneStaTight);
-  fChain->SetBranchAddress("muNTrkHits", &pfEvt_.muNTrkHits, &b_muNTrkHits);
-  fChain->SetBranchAddress("muNPixValHits", &pfEvt_.muNPixValHits, &b_muNPixValHits);
-  fChain->SetBranchAddress("muNPixWMea", &pfEvt_.muNPixWMea, &b_muNPixWMea);
-  fChain->SetBranchAddress("muNTrkWMea", &pfEvt_.muNTrkWMea, &b_muNTrkWMea);
-  fChain->SetBranchAddress("muStationsMatched", &pfEvt_.muStationsMatched, &b_muStationsMatched);
-  fChain->SetBranchAddress("muNMuValHits", &pfEvt_.muNMuValHits, &b_muNMuValHits);
-  fChain->SetBranchAddress("muDxy", &pfEvt_.muDxy, &b_muDxy);
-  fChain->SetBranchAddress("muDxyErr", &pfEvt_.muDxyErr, &b_muDxyErr);
-  fChain->SetBranchAddress("muDz", &pfEvt_.muDz, &b_muDz);
-  fChain->SetBranchAddress("muDzErr", &pfEvt_.muDzErr, &b_muDzErr);
-  fChain->SetBranchAddress("muPtInner", &pfEvt_.muPtInner, &b_muPtInner);
-  fChain->SetBranchAddress("muPtErrInner", &pfEvt_.muPtErrInner, &b_muPtErrInner);
-  fChain->SetBranchAddress("muPtGlobal", &pfEvt_.muPtGlobal, &b_muPtGlobal);
-  fChain->SetBranchAddress("muPtErrGlobal", &pfEvt_.muPtErrGlobal, &b_muPtErrGlobal);
-  fChain->SetBranchAddress("muNormChi2Inner", &pfEvt_.muNormChi2Inner, &b_muNormChi2Inner);
-  fChain->SetBranchAddress("muNormChi2Global", &pfEvt_.muNormChi2Global, &b_muNormChi2Global);
-  fChain->SetBranchAddress("muIso03_sumPt",&pfEvt_.muIso03_sumPt, &b_muIso03_sumPt);
-  fChain->SetBranchAddress("muIso04_sumPt",&pfEvt_.muIso04_sumPt, &b_muIso04_sumPt);
-  fChain->SetBranchAddress("muIso05_sumPt",&pfEvt_.muIso05_sumPt, &b_muIso05_sumPt);
-  fChain->SetBranchAddress("muIso03_emEt",&pfEvt_.muIso03_emEt, &b_muIso03_emEt);
-  fChain->SetBranchAddress("muIso04_emEt",&pfEvt_.muIso04_emEt, &b_muIso04_emEt);
-  fChain->SetBranchAddress("muIso05_emEt",&pfEvt_.muIso05_emEt, &b_muIso05_emEt);
-  fChain->SetBranchAddress("muIso03_hadEt",&pfEvt_.muIso03_hadEt, &b_muIso03_hadEt);
-  fChain->SetBranchAddress("muIso04_hadEt",&pfEvt_.muIso04_hadEt, &b_muIso04_hadEt);
-  fChain->SetBranchAddress("muIso05_hadEt",&pfEvt_.muIso05_hadEt, &b_muIso05_hadEt);
-  fChain->SetBranchAddress("muIso03_nTracks",&pfEvt_.muIso03_nTracks, &b_muIso03_nTracks);
-  fChain->SetBranchAddress("muIso04_nTracks",&pfEvt_.muIso04_nTracks, &b_muIso04_nTracks);
-  fChain->SetBranchAddress("muIso05_nTracks",&pfEvt_.muIso05_nTracks, &b_muIso05_nTracks);
-  fChain->SetBranchAddress("muNotPFMuon",&pfEvt_.muNotPFMuon, &b_muNotPFMuon);
-  fChain->SetBranchAddress("muTrig", &pfEvt_.muTrig, &b_muTrig);
-  fChain->SetBranchAddress("HLTriggers", &pfEvt_.HLTriggers, &b_HLTriggers);
-  fChain->SetBranchAddress("trigPrescale", &pfEvt_.trigPrescale, &b_trigPrescale);
+  if (activeOnly || stagedRead) SetActiveBranches();
+  if (activeOnly) {
+    fChain->SetBranchStatus("*",0);
+    cout << "Active branches (" << activeBranches.size() << "):";
+    for (set<string>::iterator it=activeBranches.begin(); it!=activeBranches.end(); ++it) {
+      fChain->SetBranchStatus(it->c_str(),1);
+      cout << " " << *it;
+    }
+    cout << endl;
+  }
+
+  // Branches the selection cannot do without, also when all branches are read
+  set<string> needed = activeBranches;
+  if (needed.empty()) {
+    SetActiveBranches();
+    needed.swap(activeBranches);
+  }
+
+  schemaError = "";
+  absentBranches.clear();
+#define PFTREE_BIND_SCALAR(type, name) BindBranch(#name, &pfEvt_.name, &b_##name, #type, needed);
+#define PFTREE_BIND_ARRAY(type, name, size) BindBranch(#name, pfEvt_.name, &b_##name, #type, needed);
+#define PFTREE_BIND_VECTOR(type, name, group) BindBranch(#name, &pfEvt_.name, &b_##name, PFTreeType<type>::Vector(), needed);
+  PFTREE_BRANCHES(PFTREE_BIND_SCALAR, PFTREE_BIND_ARRAY, PFTREE_BIND_VECTOR)
+#undef PFTREE_BIND_SCALAR
+#undef PFTREE_BIND_ARRAY
+#undef PFTREE_BIND_VECTOR
+
+  if (!absentBranches.empty() && workerId<0) {
+    cout << "Branches not bound (" << absentBranches.size() << "):";
+    for (vector<string>::size_type idx=0; idx!=absentBranches.size(); idx++) cout << " " << absentBranches[idx];
+    cout << endl;
+  }
+
+  if (stagedRead) SetStageBranches();
 }
 
 
+void TreeToDataset::SetStageBranches() {
+  // Branches read in the last stage: everything needed except the trigger/ID pre-filter
+  stageBranches.clear();
+  for (set<string>::iterator it=activeBranches.begin(); it!=activeBranches.end(); ++it) {
+    if (*it=="HLTriggers" || *it=="nMUpart" || *it=="muIsTightMuon" || *it=="muTrig") continue;
+    if (doMC && it->compare(0, 3, "gen")==0) continue;     // read in the first stage
+    stageBranches.push_back(branchHandles[*it]);
+  }
+}
+
+
+
+void TreeToDataset::SetActiveBranches() {
+  activeBranches.clear();
+  AddSelectionBranches(activeBranches);
+
+  // Muon charge and centrality for the histograms and categories
+  if (binned.Active() || categories.Active()) activeBranches.insert("muCharge");
+  if (categories.Active() && !categories.centEdges.empty()) activeBranches.insert("CentBin");
+
+  // Muon momenta and charges for the dimuon pairs
+  if (zPairs.Active()) {
+    const char *pairBranches[] = {"muPx", "muPy", "muPz", "muCharge"};
+    activeBranches.insert(pairBranches, pairBranches+4);
+  }
+
+  // Gen muons and the muon direction for the gen matching
+  if (doMC) {
+    const char *genBranches[] = {"nGENpart", "genPDGId", "genPt", "genEta", "genPhi", "muPhi"};
+    activeBranches.insert(genBranches, genBranches+6);
+  }
+
+  // Isolation variables used by CheckIsolation()
+  if (allIsolation || isoScan.Active()) AddTreeIsolationBranches(activeBranches);
+  if (configs.empty()) AddIsolationBranches(isoCut, activeBranches);
+  for (vector<SelectionConfig>::size_type idx=0; idx!=configs.size(); idx++) {
+    AddIsolationBranches(configs[idx].selection.isoCut, activeBranches);
+  }
+}
+
+
+map<string, string> TreeToDataset::InputBranches() {
+  // Branches every input file must have, whatever the isolation type, with their types
+  set<string> branches;
+  AddSelectionBranches(branches);
+  AddTreeIsolationBranches(branches);
+  map<string, string> types;
+  for (set<string>::iterator it=branches.begin(); it!=branches.end(); ++it) types[*it] = PFTreeBranchTypes().at(*it);
+  return types;
+}
+
+
+void TreeToDataset::AddSelectionBranches(set<string> &branches) {
+  // Muon ID and trigger selection
+  branches.insert("nMUpart");
+  branches.insert("muPt");
+  branches.insert("muIsTightMuon");
+  branches.insert("muTrig");
+  branches.insert("HLTriggers");
+
+  // Variables stored in the RooDataSet
+  branches.insert("recoPFMET");
+  branches.insert("muMt");
+  branches.insert("muEta");
+}
+
+
+void TreeToDataset::AddTreeIsolationBranches(set<string> &branches) {
+  // Isolation types computed from muon variables of the tree, i.e. all but the PF cones
+  const int isoCuts[] = {13, 14, 15, 2, 21, 3};
+  for (unsigned int idx=0; idx<sizeof(isoCuts)/sizeof(isoCuts[0]); idx++) AddIsolationBranches(isoCuts[idx], branches);
+}
+
+
+void TreeToDataset::AddIsolationBranches(int _isoCut, set<string> &branches) {
+  if (_isoCut==13) {
+    branches.insert("muIso03_sumPt");
+    branches.insert("muIso03_emEt");
+    branches.insert("muIso03_hadEt");
+  } else if (_isoCut==14) {
+    branches.insert("muIso04_sumPt");
+    branches.insert("muIso04_emEt");
+    branches.insert("muIso04_hadEt");
+  } else if (_isoCut==15) {
+    branches.insert("muIso05_sumPt");
+    branches.insert("muIso05_emEt");
+    branches.insert("muIso05_hadEt");
+  } else if (_isoCut==2) {
+    branches.insert("muPFBasedDBetaIso");
+  } else if (_isoCut==21) {
+    branches.insert("muSumChargedHadronPt");
+    branches.insert("muSumNeutralHadronEt");
+    branches.insert("muSumPhotonEt");
+  } else if (_isoCut==3) {
+    branches.insert("muTrackIso");
+  } else if (PFConeIso::IsConeType(_isoCut)) {
+    const char *pfBranches[] = {"nPFpart", "pfId", "pfPt", "pfEta", "pfPhi", "muPhi"};
+    branches.insert(pfBranches, pfBranches+6);
+    if (PFConeIso::Subtracted(_isoCut)) branches.insert("pfVsPt");
+  }
+}
+
 
 void TreeToDataset::MakeRooDataset() {
   TMass = new RooRealVar("TMass","Transverse Mass",0,160,"GeV/c^{2}");
@@ -574,8 +914,86 @@ void TreeToDataset::MakeRooDataset() {
   Eta = new RooRealVar("Eta","#eta",-2.4,2.4,"");
 
   RooArgList varlist(*TMass,*MET,*Pt,*Eta);
+  if (doMC) {
+    // Closest gen muon within genMatch.maxDR; GenDR is -1 and GenMother 0 without a match
+    GenPt = new RooRealVar("GenPt","Matched gen p_{T}",0,200,"GeV/c");
+    GenDR = new RooRealVar("GenDR","#DeltaR to the matched gen muon",-1,genMatch.maxDR,"");
+    GenMother = new RooRealVar("GenMother","Gen match: 0 none, 1 muon, 2 W daughter",0,2,"");
+    varlist.add(*GenPt);
+    varlist.add(*GenDR);
+    varlist.add(*GenMother);
+  }
+  if (zPairs.mode==DimuonPairs::kFlag) {
+    // Opposite-charge pair of this muon closest to the Z mass, -1 without a pair
+    PairMass = new RooRealVar("PairMass","Dimuon mass",-1,500,"GeV/c^{2}");
+    ZFlag = new RooRealVar("ZFlag","Event has a dimuon in the Z window",0,1,"");
+    varlist.add(*PairMass);
+    varlist.add(*ZFlag);
+  }
+  if (categories.Active()) {
+    Category = new RooCategory("Category","Charge, eta and centrality bin");
+    categories.Define(*Category);
+    varlist.add(*Category);
+  }
 
-  dataset = new RooDataSet("dataset","WDataSet",varlist);
+  dataset = stream.NewDataSet("dataset","WDataSet",varlist);
+
+  for (vector<SelectionConfig>::size_type idx=0; idx!=configs.size(); idx++) {
+    configs[idx].dataset = stream.NewDataSet(configs[idx].name.c_str(),"WDataSet",varlist);
+  }
+
+  // Per-category copies, filled in the same pass
+  if (categories.mode==CategoryScheme::kSplit) {
+    for (int cat=0; cat<categories.Size(); cat++) {
+      string label = categories.Label(cat);
+      splitDatasets.push_back(stream.NewDataSet(("dataset_"+label).c_str(),"WDataSet",varlist));
+      for (vector<SelectionConfig>::size_type idx=0; idx!=configs.size(); idx++) {
+        configs[idx].splits.push_back(stream.NewDataSet((configs[idx].name+"_"+label).c_str(),"WDataSet",varlist));
+      }
+    }
+  }
+
+  // Histogram binning follows the variable ranges
+  if (binned.Active()) {
+    binned.Book(TMass->getMin(), TMass->getMax(), MET->getMin(), MET->getMax());
+    for (vector<SelectionConfig>::size_type idx=0; idx!=configs.size(); idx++) configs[idx].binned.BookAs(binned);
+  }
+  if (isoScan.Active()) isoScan.Book();
 }
 
  
+
+
+bool TreeToDataset::WriteFlat(RooDataSet *data, const string &path) {
+  // Columns in dataset order, with the ranges and units of their RooRealVars;
+  // a RooCategory is stored as its index, with its labels
+  FlatDatasetWriter writer;
+  const RooArgSet *row = data->get();
+  vector<RooRealVar*> vars;
+  vector<RooCategory*> cats;
+  for (vector<string>::size_type col=0; col!=arena.names.size(); col++) {
+    RooAbsArg *arg = row->find(arena.names[col].c_str());
+    RooRealVar *var = dynamic_cast<RooRealVar*>(arg);
+    RooCategory *cat = dynamic_cast<RooCategory*>(arg);
+    if (var) writer.AddColumn(var->GetName(), var->GetTitle(), var->getUnit(), var->getMin(), var->getMax());
+    else if (cat) {
+      FlatLabels labels;
+      TIterator *types = cat->typeIterator();
+      while (RooCatType *type = (RooCatType*)types->Next()) labels.push_back(make_pair(type->getVal(), string(type->GetName())));
+      delete types;
+      writer.AddCategory(cat->GetName(), cat->GetTitle(), labels);
+    }
+    else return false;
+    writer.data.back().reserve(data->numEntries());
+    vars.push_back(var);
+    cats.push_back(cat);
+  }
+
+  for (Int_t irow=0; irow<data->numEntries(); irow++) {
+    data->get(irow);
+    for (vector<RooRealVar*>::size_type col=0; col!=vars.size(); col++) {
+      writer.data[col].push_back(vars[col] ? vars[col]->getVal() : cats[col]->getIndex());
+    }
+  }
+  return writer.Write(path.c_str());
+}